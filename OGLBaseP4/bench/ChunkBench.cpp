@@ -0,0 +1,157 @@
+/*
+ * Chunk layout benchmark matrix.
+ * Generates and meshes the same 256x256x256 block region with several compile-time
+ * chunk layouts and reports generation time, mesh time, draw calls and memory.
+ *
+ * usage: ChunkBench [seed]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "ChunkDims.h"
+#include "ChunkGenerator.h"
+#include "ChunkMesher.h"
+
+using namespace std;
+
+// world region covered by every layout, in blocks
+static const int REGION_XZ = 256;
+static const int REGION_Y = 256;
+static const int REPEATS = 3;
+
+struct LayoutResult {
+    double genMs = 0;
+    double meshMs = 0;
+    size_t chunks = 0;
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+    size_t voxelBytes = 0;
+    size_t meshBytes = 0;
+};
+
+template <class Dims>
+struct BenchChunk {
+    VoxelStorage<Dims> voxels;
+    int heights[Dims::SizeX * Dims::SizeZ];
+};
+
+template <class Dims>
+class BenchWorld {
+public:
+    enum : int {
+        CountX = REGION_XZ / Dims::SizeX,
+        CountY = REGION_Y / Dims::SizeY,
+        CountZ = REGION_XZ / Dims::SizeZ
+    };
+
+    vector<unique_ptr<BenchChunk<Dims>>> chunks;
+
+    BenchWorld() : chunks(CountX * CountY * CountZ) {}
+
+    static int slot(int cx, int cy, int cz) { return (cy * CountZ + cz) * CountX + cx; }
+
+    BenchChunk<Dims>* get(int cx, int cy, int cz) const {
+        if (cx < 0 || cx >= CountX || cy < 0 || cy >= CountY || cz < 0 || cz >= CountZ) return nullptr;
+        return chunks[slot(cx, cy, cz)].get();
+    }
+
+    // solidity of a chunk-local coordinate that may spill into a neighbour
+    bool solidAt(int cx, int cy, int cz, int x, int y, int z) const {
+        int wx = cx * Dims::SizeX + x;
+        int wy = cy * Dims::SizeY + y;
+        int wz = cz * Dims::SizeZ + z;
+        if (wx < 0 || wy < 0 || wz < 0) return false;
+        BenchChunk<Dims>* c = get(wx / Dims::SizeX, wy / Dims::SizeY, wz / Dims::SizeZ);
+        if (c == nullptr) return false;
+        return c->voxels.get(wx % Dims::SizeX, wy % Dims::SizeY, wz % Dims::SizeZ) > 0;
+    }
+};
+
+static double msSince(chrono::high_resolution_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+template <class Dims>
+LayoutResult runLayout(int seed) {
+    typedef BenchWorld<Dims> World;
+    LayoutResult best;
+    FastNoiseLite noise = makeTerrainNoise(seed);
+
+    for (int rep = 0; rep < REPEATS; rep++) {
+        LayoutResult r;
+        World world;
+
+        auto start = chrono::high_resolution_clock::now();
+        for (int cy = 0; cy < World::CountY; cy++) {
+            for (int cz = 0; cz < World::CountZ; cz++) {
+                for (int cx = 0; cx < World::CountX; cx++) {
+                    unique_ptr<BenchChunk<Dims>> chunk(new BenchChunk<Dims>());
+                    generateTerrain(chunk->voxels, cx * Dims::SizeX, cy * Dims::SizeY, cz * Dims::SizeZ,
+                                    noise, chunk->heights);
+                    // layouts that split vertically never need to keep all-air chunks around
+                    bool empty = true;
+                    for (int s = 0; s < Dims::Sections; s++) {
+                        if (chunk->voxels.sectionBlockCount[s] > 0) empty = false;
+                    }
+                    if (!empty || Dims::SizeY == REGION_Y) {
+                        world.chunks[World::slot(cx, cy, cz)] = move(chunk);
+                    }
+                }
+            }
+        }
+        r.genMs = msSince(start);
+
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        start = chrono::high_resolution_clock::now();
+        for (int cy = 0; cy < World::CountY; cy++) {
+            for (int cz = 0; cz < World::CountZ; cz++) {
+                for (int cx = 0; cx < World::CountX; cx++) {
+                    BenchChunk<Dims>* chunk = world.get(cx, cy, cz);
+                    if (chunk == nullptr) continue;
+                    r.chunks++;
+                    r.voxelBytes += sizeof(BenchChunk<Dims>);
+                    for (int s = 0; s < Dims::Sections; s++) {
+                        if (chunk->voxels.sectionBlockCount[s] == 0) continue;
+                        vertices.clear();
+                        indices.clear();
+                        ChunkMesher::meshSection(chunk->voxels, s,
+                            [&](int x, int y, int z) { return world.solidAt(cx, cy, cz, x, y, z); },
+                            vertices, indices);
+                        if (indices.empty()) continue;
+                        r.drawCalls++;
+                        r.triangles += indices.size() / 3;
+                        r.meshBytes += vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+                    }
+                }
+            }
+        }
+        r.meshMs = msSince(start);
+
+        if (rep == 0 || r.genMs + r.meshMs < best.genMs + best.meshMs) best = r;
+    }
+    return best;
+}
+
+static void printRow(const char* name, const LayoutResult& r) {
+    printf("%-12s %8.1f %8.1f %7zu %7zu %10zu %9.1f %9.1f\n", name, r.genMs, r.meshMs, r.chunks,
+           r.drawCalls, r.triangles, r.voxelBytes / (1024.0 * 1024.0), r.meshBytes / (1024.0 * 1024.0));
+}
+
+int main(int argc, char *argv[])
+{
+    int seed = argc >= 2 ? atoi(argv[1]) : 0;
+
+    printf("region %dx%dx%d blocks, seed %d, best of %d\n\n", REGION_XZ, REGION_Y, REGION_XZ, seed, REPEATS);
+    printf("%-12s %8s %8s %7s %7s %10s %9s %9s\n", "layout", "gen ms", "mesh ms", "chunks",
+           "draws", "triangles", "voxel MB", "mesh MB");
+
+    printRow("16x256x16", runLayout<ChunkDims<16, 256, 16, 16>>(seed));
+    printRow("32x256x32", runLayout<ChunkDims<32, 256, 32, 32>>(seed));
+    printRow("32x32x32", runLayout<ChunkDims<32, 32, 32, 32>>(seed));
+    return 0;
+}
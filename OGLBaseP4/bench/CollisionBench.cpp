@@ -0,0 +1,87 @@
+/*
+ * Voxel collision benchmark.
+ * Generates a world, scatters player-sized boxes above the terrain and sweeps them all by
+ * random moves each tick, on one thread and on the worker pool. Reports collision queries
+ * per second and checks that no box that started clear ends up inside a block.
+ *
+ * usage: CollisionBench [bodies] [seed]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ChunkData.h"
+#include "ThreadPool.h"
+#include "VoxelCollision.h"
+#include "World.h"
+
+using namespace std;
+
+static const int RADIUS = 8;   // chunks generated on each side of the origin
+static const int TICKS = 60;
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? (size_t)atoi(argv[1]) : 100000;
+    World::seed = argc > 2 ? atoi(argv[2]) : 0;
+
+    World world;
+    for (int x = -RADIUS; x < RADIUS; x++) {
+        for (int z = -RADIUS; z < RADIUS; z++) {
+            world.addChunk(ChunkCoord{x, z});
+        }
+    }
+    for (int x = -RADIUS; x < RADIUS; x++) {
+        for (int z = -RADIUS; z < RADIUS; z++) {
+            world.getChunk(ChunkCoord{x, z})->generateTrees();
+        }
+    }
+
+    VoxelCollider collider(world);
+    mt19937 random(1);
+    uniform_real_distribution<float> coord(-RADIUS * CHUNK_SIZE + 1.0f, RADIUS * CHUNK_SIZE - 1.0f);
+    uniform_real_distribution<float> move(-1.0f, 1.0f);
+
+    // boxes start just above the surface of their column
+    vector<VoxelCollider::Body> start(count);
+    for (VoxelCollider::Body& body : start) {
+        float x = coord(random), z = coord(random);
+        int y = CHUNK_HEIGHT - 1;
+        while (y > 0 && world.getBlock((int)floor(x), y, (int)floor(z)) == 0) y--;
+        body.box.min = glm::vec3(x - 0.3f, y + 1.0f + move(random) * 0.5f + 0.5f, z - 0.3f);
+        body.box.max = body.box.min + glm::vec3(0.6f, 1.8f, 0.6f);
+        body.hits = 0;
+    }
+
+    ThreadPool pool;
+    printf("%zu bodies, %d ticks, %u workers\n", count, TICKS, pool.size());
+    for (int threaded = 0; threaded < 2; threaded++) {
+        vector<VoxelCollider::Body> bodies = start;
+        mt19937 moves(2);
+        double ms = 0.0;
+        size_t hits = 0, inside = 0;
+        for (int tick = 0; tick < TICKS; tick++) {
+            for (VoxelCollider::Body& body : bodies) {
+                body.delta = glm::vec3(move(moves), move(moves) - 0.5f, move(moves));
+            }
+            auto begin = chrono::high_resolution_clock::now();
+            collider.sweepAll(bodies, threaded ? &pool : nullptr);
+            ms += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+
+            for (VoxelCollider::Body& body : bodies) {
+                bool wasClear = !collider.overlaps(body.box);
+                body.box.min += body.moved;
+                body.box.max += body.moved;
+                hits += body.hits != 0;
+                inside += wasClear && collider.overlaps(body.box);
+            }
+        }
+        double queries = (double)count * TICKS;
+        printf("%-8s %8.2f ms/tick  %6.2f M queries/s  %5.1f%% blocked  %zu ended inside a block\n",
+            threaded ? "workers" : "1 thread", ms / TICKS, queries / ms / 1000.0, 100.0 * hits / queries, inside);
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Pathfinding benchmark and check.
+ * Generates a world, times hierarchical path queries on one thread and on the worker pool,
+ * and compares every path with a flat breadth-first search over the blocks: paths must exist
+ * exactly when the flat search finds one, and their length over the shortest is reported.
+ * Then edits blocks through World::setBlock, so Navigation rebuilds only the changed chunks,
+ * and checks that it answers every query exactly as a Navigation built from scratch does.
+ *
+ * usage: NavigationBench [queries] [seed]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "ChunkData.h"
+#include "Navigation.h"
+#include "ThreadPool.h"
+#include "World.h"
+
+using namespace std;
+
+static const int RADIUS = 4;   // chunks generated on each side of the origin
+static const int EDIT_ROUNDS = 20;
+static const int EDITS_PER_ROUND = 20;
+
+struct Query {
+    glm::vec3 start, goal;
+};
+
+static int surface(World& world, int x, int z) {
+    int y = CHUNK_HEIGHT - 1;
+    while (y > 0 && world.getBlock(x, y, z) == 0) y--;
+    return y + 1;
+}
+
+static bool walkable(World& world, int x, int y, int z) {
+    return y > 0 && world.getChunk(world.worldToChunk(x, z)) && world.getBlock(x, y, z) == 0 &&
+           world.getBlock(x, y + 1, z) == 0 && world.getBlock(x, y - 1, z) != 0;
+}
+
+// Fewest steps between two feet positions under Navigation's rules, or -1
+static int flatDistance(World& world, const glm::ivec3& from, const glm::ivec3& to) {
+    static const int NEIGHBOURS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    auto key = [](int x, int y, int z) {
+        return ((int64_t)(x + 32768) << 40) | ((int64_t)(z + 32768) << 20) | (int64_t)y;
+    };
+    if (!walkable(world, from.x, from.y, from.z) || !walkable(world, to.x, to.y, to.z)) return -1;
+    unordered_map<int64_t, int> distance;
+    queue<glm::ivec3> frontier;
+    distance[key(from.x, from.y, from.z)] = 0;
+    frontier.push(from);
+    while (!frontier.empty()) {
+        glm::ivec3 cell = frontier.front();
+        frontier.pop();
+        int d = distance[key(cell.x, cell.y, cell.z)];
+        if (cell == to) return d;
+        for (const auto& offset : NEIGHBOURS) {
+            for (int dy = -1; dy <= 1; dy++) {
+                glm::ivec3 next(cell.x + offset[0], cell.y + dy, cell.z + offset[1]);
+                if (!walkable(world, next.x, next.y, next.z)) continue;
+                // a step up or down needs a third block of air above the lower cell
+                if (dy > 0 && world.getBlock(cell.x, cell.y + 2, cell.z) != 0) continue;
+                if (dy < 0 && world.getBlock(next.x, next.y + 2, next.z) != 0) continue;
+                if (!distance.emplace(key(next.x, next.y, next.z), d + 1).second) continue;
+                frontier.push(next);
+            }
+        }
+    }
+    return -1;
+}
+
+static glm::ivec3 cellOf(const glm::vec3& feet) {
+    return glm::ivec3((int)floor(feet.x), (int)feet.y, (int)floor(feet.z));
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? (size_t)atoi(argv[1]) : 300;
+    World::seed = argc > 2 ? atoi(argv[2]) : 0;
+
+    World world;
+    vector<ChunkCoord> coords;
+    for (int x = -RADIUS; x < RADIUS; x++) {
+        for (int z = -RADIUS; z < RADIUS; z++) {
+            world.addChunk(ChunkCoord{x, z});
+            coords.push_back(ChunkCoord{x, z});
+        }
+    }
+    for (const ChunkCoord& coord : coords) world.getChunk(coord)->generateTrees();
+
+    Navigation navigation(world);
+    world.onBlockChanged = [&navigation](int x, int y, int z) { navigation.blockChanged(x, y, z); };
+    auto begin = chrono::high_resolution_clock::now();
+    for (const ChunkCoord& coord : coords) navigation.addChunk(coord);
+    double buildMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+    printf("%zu chunks, %zu portals, built in %.1f ms\n", navigation.chunkCount(), navigation.portalCount(), buildMs);
+
+    mt19937 random(1);
+    uniform_int_distribution<int> coord(-RADIUS * CHUNK_SIZE + 1, RADIUS * CHUNK_SIZE - 2);
+    auto randomFeet = [&]() {
+        int x = coord(random), z = coord(random);
+        return glm::vec3(x + 0.5f, (float)surface(world, x, z), z + 0.5f);
+    };
+    vector<Query> queries(count);
+    for (Query& query : queries) query = Query{randomFeet(), randomFeet()};
+
+    // timing, then every path against the flat search
+    ThreadPool pool;
+    vector<Navigation::Path> paths(count);
+    begin = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; i++) paths[i] = navigation.findPath(queries[i].start, queries[i].goal);
+    double serialMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+    begin = chrono::high_resolution_clock::now();
+    vector<future<Navigation::Path>> pending;
+    for (const Query& query : queries) pending.push_back(navigation.requestPath(pool, query.start, query.goal));
+    for (future<Navigation::Path>& path : pending) path.get();
+    double pooledMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+    printf("%zu queries: %.3f ms each on one thread, %.3f ms each on %u workers\n", count, serialMs / count,
+           pooledMs / count, pool.size());
+
+    int missed = 0, spurious = 0, compared = 0;
+    double ratioSum = 0.0, ratioMax = 1.0;
+    for (size_t i = 0; i < count; i++) {
+        int shortest = flatDistance(world, cellOf(queries[i].start), cellOf(queries[i].goal));
+        if (shortest >= 0 && paths[i].empty()) missed++;
+        if (shortest < 0 && !paths[i].empty()) spurious++;
+        if (shortest > 0 && !paths[i].empty()) {
+            double ratio = (paths[i].size() - 1.0) / shortest;
+            ratioSum += ratio;
+            ratioMax = max(ratioMax, ratio);
+            compared++;
+        }
+    }
+    printf("against the flat search: %d missed, %d spurious, length ratio %.3f mean, %.3f max\n", missed, spurious,
+           compared ? ratioSum / compared : 1.0, ratioMax);
+
+    // edits: dig holes and stack blocks, borders included, then compare with a full rebuild
+    uniform_int_distribution<int> offset(-2, 2);
+    uniform_int_distribution<int> coin(0, 1);
+    int differing = 0;
+    double updateMs = 0.0;
+    for (int round = 0; round < EDIT_ROUNDS; round++) {
+        for (int e = 0; e < EDITS_PER_ROUND; e++) {
+            int x = coord(random), z = coord(random);
+            if (e % 4 == 0) x = (x / CHUNK_SIZE) * CHUNK_SIZE - coin(random); // on a chunk border
+            int y = surface(world, x, z) + offset(random);
+            world.setBlock(x, y, z, coin(random) ? 0 : 1);
+        }
+        begin = chrono::high_resolution_clock::now();
+        int rebuilt = navigation.update();
+        updateMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+
+        Navigation fresh(world);
+        for (const ChunkCoord& c : coords) fresh.addChunk(c);
+        if (fresh.portalCount() != navigation.portalCount()) differing++;
+        for (const Query& query : queries) {
+            glm::vec3 start(query.start.x, (float)surface(world, (int)floor(query.start.x), (int)floor(query.start.z)), query.start.z);
+            glm::vec3 goal(query.goal.x, (float)surface(world, (int)floor(query.goal.x), (int)floor(query.goal.z)), query.goal.z);
+            if (navigation.findPath(start, goal).size() != fresh.findPath(start, goal).size()) differing++;
+        }
+        printf("edit round %d: %d chunks rebuilt, %zu portals\n", round, rebuilt, navigation.portalCount());
+    }
+    printf("after %d edits: %.2f ms per incremental update, %d answers differ from a full rebuild\n",
+           EDIT_ROUNDS * EDITS_PER_ROUND, updateMs / EDIT_ROUNDS, differing);
+
+    return missed == 0 && spurious == 0 && differing == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * Particle depth sort benchmark.
+ * Sorts random particle clouds back to front three ways, from 300 up to 1M particles:
+ * shared_ptr particles with a by-value comparator that transforms both points on every
+ * comparison (the old particleSys), std::sort of an index array over precomputed depths, and
+ * DepthSort's radix sort on quantized depth. Also checks the radix order.
+ *
+ * usage: ParticleSortBench [max particles]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "DepthSort.h"
+
+using namespace std;
+
+static const size_t WORK = 3000000; // particles sorted per measurement, over repeated runs
+static const size_t COUNTS[] = {300, 3000, 30000, 300000, 1000000};
+
+// The sort particleSys used before: shared_ptr arguments by value, depth recomputed per call
+struct OldParticle {
+    glm::vec3 x;
+};
+struct OldSorter {
+    bool operator()(const shared_ptr<OldParticle> p0, const shared_ptr<OldParticle> p1) const {
+        glm::vec4 x0w = C * glm::vec4(p0->x, 1.0f);
+        glm::vec4 x1w = C * glm::vec4(p1->x, 1.0f);
+        return x0w.z < x1w.z;
+    }
+    glm::mat4 C;
+};
+
+template <class F>
+double timeRuns(size_t runs, F fn) {
+    auto begin = chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < runs; r++) fn();
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count() / runs;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxCount = argc > 1 ? (size_t)atoi(argv[1]) : 1000000;
+    glm::mat4 view = glm::lookAt(glm::vec3(4.0f, 3.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec3 viewZ(view[0][2], view[1][2], view[2][2]);
+    mt19937 random(1);
+    uniform_real_distribution<float> coord(-2.0f, 2.0f);
+
+    printf("%9s %14s %14s %14s %10s\n", "particles", "shared_ptr", "index sort", "radix", "speedup");
+    for (size_t count : COUNTS) {
+        if (count > maxCount) break;
+        size_t runs = max<size_t>(1, WORK / count);
+        vector<glm::vec3> positions(count);
+        for (glm::vec3& p : positions) p = glm::vec3(coord(random), coord(random), coord(random));
+
+        vector<shared_ptr<OldParticle>> particles;
+        for (const glm::vec3& p : positions) particles.push_back(make_shared<OldParticle>(OldParticle{p}));
+        OldSorter oldSorter;
+        oldSorter.C = view;
+        double oldMs = timeRuns(runs, [&]() {
+            shuffle(particles.begin(), particles.end(), random);
+            sort(particles.begin(), particles.end(), oldSorter);
+        });
+        double shuffleMs = timeRuns(runs, [&]() { shuffle(particles.begin(), particles.end(), random); });
+        oldMs -= shuffleMs;
+
+        // depth keys in one pass, as the particle update writes them
+        vector<float> depth(count);
+        for (size_t i = 0; i < count; i++) depth[i] = glm::dot(viewZ, positions[i]);
+
+        vector<uint32_t> order(count);
+        double indexMs = timeRuns(runs, [&]() {
+            for (size_t i = 0; i < count; i++) order[i] = (uint32_t)i;
+            sort(order.begin(), order.end(), [&depth](uint32_t a, uint32_t b) { return depth[a] < depth[b]; });
+        });
+
+        DepthSort radix;
+        double radixMs = timeRuns(runs, [&]() { radix.sort(depth.data(), count, order); });
+
+        // neighbours may only be out of order by less than one quantization step
+        float range = *max_element(depth.begin(), depth.end()) - *min_element(depth.begin(), depth.end());
+        size_t misordered = 0;
+        for (size_t i = 1; i < count; i++) {
+            misordered += depth[order[i - 1]] > depth[order[i]] + range / 65535.0f;
+        }
+
+        printf("%9zu %11.3f ms %11.3f ms %11.3f ms %9.1fx%s\n", count, oldMs, indexMs, radixMs, oldMs / radixMs,
+            misordered ? "  MISORDERED" : "");
+    }
+    return 0;
+}
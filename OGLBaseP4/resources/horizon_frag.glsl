@@ -0,0 +1,23 @@
+#version 330 core
+uniform sampler2D colorMap;
+uniform vec3 lightDir;
+// min x, min z, max x, max z of the loaded chunks, which draw the real terrain
+uniform vec4 loadedBounds;
+
+in vec3 fragNor;
+in vec3 wPos;
+in vec2 vTexCoord;
+
+out vec4 Outcolor;
+
+void main() {
+	if (wPos.x > loadedBounds.x && wPos.x < loadedBounds.z &&
+	    wPos.z > loadedBounds.y && wPos.z < loadedBounds.w) {
+		discard;
+	}
+
+	vec3 color = texture(colorMap, vTexCoord).rgb;
+	float dC = max(0.0, dot(normalize(fragNor), normalize(lightDir)));
+
+	Outcolor = vec4(color * (0.3 + 0.7 * dC), 1.0);
+}
@@ -0,0 +1,40 @@
+#version 330 core
+// x,z span the tile in [0,1]; y is 1 on the skirt ring
+layout(location = 0) in vec3 vertGrid;
+
+layout(std140) uniform FrameData {
+  mat4 P;
+  mat4 V;
+  vec4 lightPos;
+  vec4 time; // x: seconds since startup
+};
+uniform mat4 farP; // own projection reaching past the chunk far plane
+uniform sampler2D heightMap;
+uniform vec2 tileOrigin;
+uniform float tileSize;
+uniform float texels;
+uniform float mipLevel;
+
+out vec3 fragNor;
+out vec3 wPos;
+out vec2 vTexCoord;
+
+float heightAt(vec2 uv) {
+  return textureLod(heightMap, uv, mipLevel).r;
+}
+
+void main() {
+  /* sample at texel centres so neighbouring tiles agree on their shared edge */
+  vec2 uv = (vertGrid.xz * (texels - 1.0) + 0.5) / texels;
+  float h = heightAt(uv);
+
+  float du = exp2(mipLevel) / texels;
+  float spacing = tileSize / (texels - 1.0) * exp2(mipLevel);
+  float hx = heightAt(uv + vec2(du, 0.0)) - heightAt(uv - vec2(du, 0.0));
+  float hz = heightAt(uv + vec2(0.0, du)) - heightAt(uv - vec2(0.0, du));
+  fragNor = normalize(vec3(-hx, 2.0 * spacing, -hz));
+
+  wPos = vec3(tileOrigin.x + vertGrid.x * tileSize, h - vertGrid.y * 16.0, tileOrigin.y + vertGrid.z * tileSize);
+  gl_Position = farP * V * vec4(wPos, 1.0);
+  vTexCoord = uv;
+}
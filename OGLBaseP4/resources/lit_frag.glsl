@@ -0,0 +1,53 @@
+#version 330 core
+// Variants are compiled with these defined in front of the source:
+//   TEXTURED  colour from Texture0, otherwise from MatColor
+//   FLIP      light the back of the surface (inward-facing normals)
+//   FOG       fade to the clear colour between fogRange.x and fogRange.y eye distance
+//   INSTANCED vertex shader only: per-instance position and yaw
+//   SPIN      vertex shader only: instances also spin and bob with the frame time
+//   RIGGED    vertex shader only: M is an array of part matrices indexed by vertPart
+#ifdef TEXTURED
+uniform sampler2D Texture0;
+#else
+uniform vec3 MatColor;
+#endif
+uniform float MatShine;
+#ifdef FOG
+uniform vec2 fogRange;
+const vec3 fogColor = vec3(0.12, 0.34, 0.56); // matches glClearColor
+#endif
+
+in vec2 vTexCoord;
+in vec3 fragNor;
+in vec3 lightDir;
+in vec3 EPos;
+
+
+out vec4 Outcolor;
+
+
+void main() {
+#ifdef FLIP
+	vec3 normal = -normalize(fragNor);
+#else
+	vec3 normal = normalize(fragNor);
+#endif
+
+	vec3 light = normalize(lightDir);
+	float dC = max(0.0, dot(normal, light));
+
+#ifdef TEXTURED
+	vec3 baseColor = texture(Texture0, vTexCoord).xyz;
+#else
+	vec3 baseColor = MatColor;
+#endif
+
+	vec3 halfV = normalize(-1*EPos) + normalize(light);
+	float sC = pow(max(dot(normalize(halfV), normal), 0), MatShine);
+	
+	vec3 color = baseColor * 0.1 + dC*baseColor + sC * baseColor;
+#ifdef FOG
+	color = mix(color, fogColor, smoothstep(fogRange.x, fogRange.y, length(EPos)));
+#endif
+	Outcolor = vec4(color, 1.0);
+}
@@ -0,0 +1,60 @@
+#version  330 core
+layout(location = 0) in vec3 vertPos;
+layout(location = 1) in vec3 vertNor;
+layout(location = 2) in vec2 vertTex;
+#ifdef INSTANCED
+layout(location = 3) in vec4 instancePose; // xyz position, w yaw
+#endif
+#ifdef RIGGED
+#define RIG_PARTS 8
+layout(location = 4) in uint vertPart;
+#endif
+
+layout(std140) uniform FrameData {
+  mat4 P;
+  mat4 V;
+  vec4 lightPos;
+  vec4 time; // x: seconds since startup
+};
+#ifdef RIGGED
+uniform mat4 M[RIG_PARTS]; // one matrix per character part
+#else
+uniform mat4 M;
+#endif
+
+out vec3 fragNor;
+out vec3 lightDir;
+out vec3 EPos;
+out vec2 vTexCoord;
+
+void main() {
+#ifdef RIGGED
+  mat4 model = M[vertPart];
+#else
+  mat4 model = M;
+#endif
+#ifdef INSTANCED
+  // M is the scale and centring every instance shares
+  float yaw = instancePose.w;
+  vec3 offset = instancePose.xyz;
+#ifdef SPIN
+  // collectibles spin and bob in place
+  yaw += radians(45.0) * time.x;
+  offset.y += 0.2 * sin(2.0 * time.x);
+#endif
+  float c = cos(yaw), s = sin(yaw);
+  model = mat4(c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  0, 0, 0, 1) * model;
+  model[3].xyz += offset;
+#endif
+
+  /* First model transforms */
+  vec3 wPos = vec3(model * vec4(vertPos.xyz, 1.0));
+  gl_Position = P * V * vec4(wPos, 1.0);
+
+  fragNor = (V*model * vec4(vertNor, 0.0)).xyz;
+  lightDir = (V*(vec4(lightPos.xyz - wPos, 0.0))).xyz;
+  EPos = (V * vec4(wPos, 1.0)).xyz;
+  
+  /* pass through the texture coordinates to be interpolated */
+  vTexCoord = vertTex;
+}
@@ -0,0 +1,9 @@
+#version 330 core
+
+// Never runs: the update pass discards rasterization and only keeps the captured varyings
+out vec4 outColor;
+
+void main()
+{
+	outColor = vec4(0.0);
+}
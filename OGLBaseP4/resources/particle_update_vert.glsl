@@ -0,0 +1,76 @@
+#version 330 core
+
+// One particle per vertex. The outputs are captured into the other state buffer by transform
+// feedback with rasterization discarded, so the whole simulation stays on the GPU.
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in float inAge;
+layout(location = 2) in vec3 inVelocity;
+layout(location = 3) in float inLife;
+layout(location = 4) in uint inSeed;
+
+// emitter parameters, the only thing the CPU sets
+uniform vec3 source;
+uniform float h;         // time step
+uniform bool restart;    // rebirth every particle this step
+uniform vec3 velocityMin;
+uniform vec3 velocityMax;
+uniform vec2 lifeRange;
+uniform vec3 colorMin;
+uniform vec3 colorMax;
+
+out vec3 outPosition;
+out float outAge;
+out vec3 outVelocity;
+out float outLife;
+out vec4 outColor;
+flat out uint outSeed;
+
+uint hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+float random01(inout uint state)
+{
+	state = hash(state);
+	return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void main()
+{
+	uint seed = inSeed;
+	vec3 position = inPosition;
+	vec3 velocity = inVelocity;
+	float age = inAge + h;
+	float life = inLife;
+
+	// a particle is reborn from the next value of its own seed
+	if (restart || age >= life)
+	{
+		seed = hash(seed + 1u);
+		uint state = seed;
+		position = source;
+		velocity = mix(velocityMin, velocityMax, vec3(random01(state), random01(state), random01(state)));
+		life = mix(lifeRange.x, lifeRange.y, random01(state));
+		age = 0.0;
+	}
+
+	//very simple update
+	position += h * velocity;
+
+	// colour depends only on the seed, so it is the same every step of one life
+	uint colorState = seed ^ 0x9e3779b9u;
+	vec3 color = mix(colorMin, colorMax, vec3(random01(colorState), random01(colorState), random01(colorState)));
+
+	outPosition = position;
+	outAge = age;
+	outVelocity = velocity;
+	outLife = life;
+	outColor = vec4(color, 1.0 - age / life);
+	outSeed = seed;
+}
@@ -1,15 +1,17 @@
 #version 330 core
 
 layout(location = 0) in vec3 vertPos;
-
-uniform mat4 P;
+layout(location = 1) in vec4 vertCol; // rgb, alpha fading over the particle's life
+
+layout(std140) uniform FrameData {
+  mat4 P;
+  mat4 V;
+  vec4 lightPos;
+  vec4 time; // x: seconds since startup
+};
 uniform mat4 M;
-uniform mat4 V;
-
-//replace with an attribute
-uniform vec3 pColor;
 
-out vec3 partCol;
+out vec4 partCol;
 
 
 void main()
@@ -23,5 +25,5 @@ void main()
 
 	gl_Position = P *V* M0 * vec4(vertPos.xyz, 1.0);
 
-	partCol = pColor;
+	partCol = vertCol;
 }
@@ -2,15 +2,20 @@
 layout(location = 0) in vec3 vertPos;
 layout(location = 1) in vec3 vertNor;
 
-uniform mat4 P;
+layout(std140) uniform FrameData {
+  mat4 P;
+  mat4 V;
+  vec4 lightPos;
+  vec4 time; // x: seconds since startup
+};
 uniform mat4 M;
-uniform mat4 V;
 
 out vec3 vTexCoord;
 
 void main() {
     vec3 test = vertNor;
     vTexCoord = vertPos;
-    vec4 pos = P * V * M * vec4(vertPos, 1.0);
+    // drop the camera translation so the box stays centred on the viewer
+    vec4 pos = P * mat4(mat3(V)) * M * vec4(vertPos, 1.0);
     gl_Position = pos.xyww; // Maximize depth to 1.0
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "AssetArchive.h"
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AssetArchive
+{
+	namespace
+	{
+		const unsigned char *base = nullptr;
+		size_t mappedSize = 0;
+		std::string rootPrefix;
+		std::unordered_map<std::string, const Entry *> entries;
+#ifdef _WIN32
+		HANDLE fileHandle = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#endif
+
+		const unsigned char *mapFile(const std::string &file, size_t &size)
+		{
+#ifdef _WIN32
+			fileHandle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (fileHandle == INVALID_HANDLE_VALUE)
+			{
+				return nullptr;
+			}
+			LARGE_INTEGER length;
+			GetFileSizeEx(fileHandle, &length);
+			size = (size_t)length.QuadPart;
+			mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			return mapping ? (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+			int fd = open(file.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				return nullptr;
+			}
+			struct stat info;
+			void *data = MAP_FAILED;
+			if (fstat(fd, &info) == 0 && info.st_size > 0)
+			{
+				size = (size_t)info.st_size;
+				data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			}
+			close(fd); // the mapping keeps the file alive
+			return data == MAP_FAILED ? nullptr : (const unsigned char *)data;
+#endif
+		}
+
+		void unmapFile()
+		{
+#ifdef _WIN32
+			if (base) UnmapViewOfFile(base);
+			if (mapping) CloseHandle(mapping);
+			if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+			mapping = nullptr;
+			fileHandle = INVALID_HANDLE_VALUE;
+#else
+			if (base) munmap((void *)base, mappedSize);
+#endif
+			base = nullptr;
+			mappedSize = 0;
+		}
+
+		std::string normalize(std::string path)
+		{
+			for (char &c : path)
+			{
+				if (c == '\\') c = '/';
+			}
+			return path;
+		}
+	}
+
+	bool stamp(const std::string &path, Stamp &out)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+		{
+			return false;
+		}
+		out.time = (uint64_t)info.st_mtime;
+		out.size = (uint64_t)info.st_size;
+		return true;
+	}
+
+	bool mount(const std::string &file, const std::string &root)
+	{
+		unmount();
+		base = mapFile(file, mappedSize);
+		if (!base)
+		{
+			unmapFile();
+			return false;
+		}
+
+		Header header;
+		bool valid = mappedSize >= sizeof(header);
+		if (valid)
+		{
+			memcpy(&header, base, sizeof(header));
+			valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+				header.tableOffset <= mappedSize && header.tableOffset % ALIGNMENT == 0 &&
+				header.entryCount <= (mappedSize - header.tableOffset) / sizeof(Entry);
+		}
+		if (!valid)
+		{
+			std::cerr << file << " is not an asset archive of version " << VERSION << std::endl;
+			unmapFile();
+			return false;
+		}
+
+		const Entry *table = (const Entry *)(base + header.tableOffset);
+		for (uint32_t i = 0; i < header.entryCount; i++)
+		{
+			const Entry &entry = table[i];
+			if (entry.offset + entry.size > mappedSize || entry.name[NAME_LENGTH - 1] != '\0')
+			{
+				std::cerr << file << " has a damaged entry " << i << std::endl;
+				continue;
+			}
+			entries[entry.name] = &entry;
+		}
+
+		rootPrefix = normalize(root);
+		if (!rootPrefix.empty() && rootPrefix.back() != '/')
+		{
+			rootPrefix += '/';
+		}
+		return true;
+	}
+
+	void unmount()
+	{
+		entries.clear();
+		unmapFile();
+	}
+
+	bool isMounted()
+	{
+		return base != nullptr;
+	}
+
+	bool find(const std::string &path, Type type, Blob &out)
+	{
+		if (!base)
+		{
+			return false;
+		}
+		std::string name = normalize(path);
+		if (name.compare(0, rootPrefix.size(), rootPrefix) != 0)
+		{
+			return false;
+		}
+		auto it = entries.find(name.substr(rootPrefix.size()));
+		if (it == entries.end() || it->second->type != (uint32_t)type)
+		{
+			return false;
+		}
+		// an edited loose file wins over what was packed from it
+		Stamp loose;
+		if (stamp(path, loose) && (loose.time > it->second->sourceTime || loose.size != it->second->sourceSize))
+		{
+			std::cerr << path << " changed since it was packed, loading it instead" << std::endl;
+			return false;
+		}
+		out.data = base + it->second->offset;
+		out.size = (size_t)it->second->size;
+		return true;
+	}
+}
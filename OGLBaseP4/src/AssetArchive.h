@@ -0,0 +1,75 @@
+#pragma once
+#ifndef LAB471_ASSETARCHIVE_H_INCLUDED
+#define LAB471_ASSETARCHIVE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a packed asset file (see tools/PackAssets.cpp) mapped into memory.
+// Shader sources are stored as text, images in the baked mip format and OBJ files as
+// interleaved meshes, so loading an asset is a lookup and pointer arithmetic into the map.
+// Lookups take the same paths as the loose files; the mount root is stripped to find the entry.
+// Each entry records the modification time and size of the file it was packed from, and a
+// loose file that has changed since is used instead of its stale entry.
+namespace AssetArchive
+{
+	enum Type
+	{
+		ASSET_TEXT = 1,
+		ASSET_IMAGE = 2,
+		ASSET_MESHES = 3
+	};
+
+	const char MAGIC[8] = { 'O', 'G', 'L', 'P', 'A', 'C', 'K', '\0' };
+	const uint32_t VERSION = 2;
+	const size_t NAME_LENGTH = 112;
+	const size_t ALIGNMENT = 16; // every blob and the entry table start on this boundary
+
+	// File layout: Header, blobs, then entryCount Entries at tableOffset
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t entryCount;
+		uint64_t tableOffset;
+	};
+
+	struct Entry
+	{
+		char name[NAME_LENGTH]; // relative to the packed directory, '/' separated
+		uint32_t type;
+		uint32_t reserved;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t sourceTime; // modification time of the packed file, in seconds
+		uint64_t sourceSize;
+	};
+
+	static_assert(ALIGNMENT % alignof(Entry) == 0, "the entry table is read in place");
+
+	struct Blob
+	{
+		const unsigned char *data = nullptr;
+		size_t size = 0;
+	};
+
+	// Modification time and size of a file on disk
+	struct Stamp
+	{
+		uint64_t time = 0;
+		uint64_t size = 0;
+	};
+	bool stamp(const std::string &path, Stamp &out);
+
+	// Map file and serve lookups under root (e.g. "../resources") from it
+	bool mount(const std::string &file, const std::string &root);
+	void unmount();
+	bool isMounted();
+
+	// False when nothing is mounted, the archive has no such entry of that type, or the loose
+	// file at path has changed since it was packed
+	bool find(const std::string &path, Type type, Blob &out);
+}
+
+#endif // LAB471_ASSETARCHIVE_H_INCLUDED
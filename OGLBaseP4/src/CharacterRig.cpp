@@ -0,0 +1,59 @@
+#include "CharacterRig.h"
+#include <cassert>
+#include <glm/gtc/matrix_transform.hpp>
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "Shape.h"
+
+CharacterRig::~CharacterRig() {
+    GLState::deleteBuffers(1, &partVBO);
+}
+
+void CharacterRig::init(const std::vector<std::shared_ptr<Shape>>& parts, const std::vector<Joint>& rigJoints,
+                        const glm::mat4& bindPose) {
+    assert(parts.size() == rigJoints.size() && parts.size() <= (size_t)MAX_PARTS);
+    joints = rigJoints;
+    bind = bindPose;
+
+    std::vector<GLubyte> partOf;
+    merged = MeshData();
+    for (size_t p = 0; p < parts.size(); p++) {
+        const MeshView& mesh = parts[p]->getMesh();
+        unsigned int base = (unsigned int)merged.vertices.size();
+        merged.vertices.insert(merged.vertices.end(), mesh.vertices, mesh.vertices + mesh.vertexCount);
+        for (size_t i = 0; i < mesh.indexCount; i++) {
+            merged.indices.push_back(base + mesh.indices[i]);
+        }
+        partOf.insert(partOf.end(), mesh.vertexCount, (GLubyte)p);
+    }
+    merged.bounds = measureMesh(merged.vertices.data(), merged.vertices.size());
+
+    shape = std::make_shared<Shape>(true);
+    shape->createShape(viewOf(merged));
+    shape->init();
+
+    glGenBuffers(1, &partVBO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, partVBO);
+    glBufferData(GL_ARRAY_BUFFER, partOf.size(), partOf.data(), GL_STATIC_DRAW);
+    shape->setIntegerAttribute(PART_ATTRIBUTE, partVBO, 1, GL_UNSIGNED_BYTE);
+}
+
+void CharacterRig::pose(const glm::mat4& root, const float* angles, glm::mat4* out) const {
+    // joint transforms without the bind pose, so children build on their parent's swing
+    glm::mat4 world[MAX_PARTS];
+    for (size_t j = 0; j < joints.size(); j++) {
+        const Joint& joint = joints[j];
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), joint.pivot) *
+                          glm::rotate(glm::mat4(1.0f), angles[j], joint.axis) *
+                          glm::translate(glm::mat4(1.0f), -joint.pivot);
+        world[j] = (joint.parent < 0 ? root : world[joint.parent]) * local;
+        out[j] = world[j] * bind;
+    }
+}
+
+void CharacterRig::submit(RenderQueue& queue, int material, const glm::mat4& root, const float* angles) {
+    glm::mat4 parts[MAX_PARTS];
+    pose(root, angles, parts);
+    queue.submitModelArray(RenderQueue::PASS_OPAQUE, material, shape->getVAO(), shape->getIndexCount(),
+                           queue.addModels(parts, partCount()), partCount(), glm::vec3(root[3]));
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshData.h"
+
+class RenderQueue;
+class Shape;
+
+// A character whose parts are merged into one mesh, each vertex tagged with the part it came
+// from. A small joint hierarchy turns per-joint swing angles into one matrix per part; the lit
+// shader's RIGGED variant takes them as its M array and picks the vertex's, so drawing the whole
+// character is one draw call and one uniform upload no matter how many parts it has.
+class CharacterRig {
+public:
+    static const int MAX_PARTS = 8;   // RIG_PARTS in lit_vert.glsl
+    enum { PART_ATTRIBUTE = 4 };      // vertPart in lit_vert.glsl
+
+    // One joint per part; part i of the merged mesh moves with joint i
+    struct Joint {
+        int parent;       // earlier joint, or -1 for the root
+        glm::vec3 pivot;  // point the joint swings about, in character space
+        glm::vec3 axis;   // swing axis
+    };
+
+    ~CharacterRig();
+    // Merge parts (already loaded and initialized) into one shape. bind maps each part's mesh
+    // into character space and is applied before the joints.
+    void init(const std::vector<std::shared_ptr<Shape>>& parts, const std::vector<Joint>& joints,
+              const glm::mat4& bind);
+    // World matrix of every part, parents before children; angles holds one per joint
+    void pose(const glm::mat4& root, const float* angles, glm::mat4* out) const;
+    void submit(RenderQueue& queue, int material, const glm::mat4& root, const float* angles);
+
+    int partCount() const { return (int)joints.size(); }
+
+private:
+    std::vector<Joint> joints;
+    glm::mat4 bind;
+    MeshData merged;
+    std::shared_ptr<Shape> shape;
+    GLuint partVBO = 0;
+};
@@ -1,75 +1,50 @@
-#include "FastNoiseLite.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <cstdlib>
 #include "ChunkData.h"
+#include "ChunkGenerator.h"
 #include "World.h"
 
-ChunkData::ChunkData(int x, int z, World* world, int seed) : chunkX(x), chunkZ(z), world(world), seed(seed) {
-    voxels.resize(CHUNK_SIZE, std::vector<std::vector<int>>(CHUNK_HEIGHT, std::vector<int>(CHUNK_SIZE, 0)));
+ChunkData::ChunkData(int x, int z, World* world, int seed) : seed(seed), world(world), chunkX(x), chunkZ(z) {
     generateTerrain();
+    dirtySections.set();
 }
 
-glm::vec2 ChunkData::getChunkCoords()
+// A full section whose six neighbouring sections are also full has no visible faces
+bool ChunkData::isSectionEnclosed(int section) const {
+    if (!isSectionFull(section)) return false;
+    if (section == 0 || !isSectionFull(section - 1)) return false;
+    if (section == SECTIONS_PER_CHUNK - 1 || !isSectionFull(section + 1)) return false;
+
+    static const int offsets[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    for (int i = 0; i < 4; i++) {
+        ChunkData* neighbor = world->getChunk({chunkX + offsets[i][0], chunkZ + offsets[i][1]});
+        if (neighbor == nullptr || !neighbor->isSectionFull(section)) return false;
+    }
+    return true;
+}
+
+void ChunkData::markSectionDirty(int section) {
+    if (section < 0 || section >= SECTIONS_PER_CHUNK) return;
+    dirtySections.set(section);
+}
+
+glm::vec2 ChunkData::getChunkCoords() const
 {
     return glm::vec2(chunkX * CHUNK_SIZE, chunkZ * CHUNK_SIZE);
 }
 
 void ChunkData::generateTerrain() {
-    FastNoiseLite noise;
-    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2S);
-    noise.SetFractalType(FastNoiseLite::FractalType_FBm);
-    // seed - 342378
-    // noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-    // noise.SetFractalType(FastNoiseLite::FractalType_Ridged);
-    noise.SetFractalOctaves(3);
-    noise.SetSeed(seed);
-    for (int x = 0; x < CHUNK_SIZE; x++) {
-        for (int z = 0; z < CHUNK_SIZE; z++) {
-            float worldX = (chunkX * CHUNK_SIZE + x);
-            float worldZ = (chunkZ * CHUNK_SIZE + z);
-            float value = noise.GetNoise(worldX, worldZ);
-            int height = (value + 1) * 30; 
-            for (int y = 0; y < CHUNK_HEIGHT; y++) {
-                
-                int voxelY = y;
-                if (voxelY == height) {
-                    if(x == 0 && z == 0){
-                        origin = glm::vec3(x,y,z);
-                    }
-                    voxels[x][y][z] = 1; // grass top block
-                }
-                if (voxelY < height) {
-                    voxels[x][y][z] = 2; // dirt lower block
-                } 
-            }
-        }
-    }
+    FastNoiseLite noise = makeTerrainNoise(seed);
+    ::generateTerrain(voxels, chunkX * CHUNK_SIZE, 0, chunkZ * CHUNK_SIZE, noise, heights);
+    origin = glm::vec3(0, getHeight(0, 0), 0);
 }
 void ChunkData::generateTrees() {
-    FastNoiseLite noise;
-    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2S);
-    noise.SetFractalType(FastNoiseLite::FractalType_FBm);
-    // noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2); 
-    // noise.SetFractalType(FastNoiseLite::FractalType_Ridged);
-    noise.SetFractalOctaves(3);
-    noise.SetSeed(seed);
-    
     for (int x = 0; x < CHUNK_SIZE; x++) {
         for (int z = 0; z < CHUNK_SIZE; z++) {
-            float worldX = (chunkX * CHUNK_SIZE + x);
-            float worldZ = (chunkZ * CHUNK_SIZE + z);
-            float value = noise.GetNoise(worldX, worldZ);
-            int height = (value + 1) * 30; 
-            for (int y = 0; y < CHUNK_HEIGHT; y++) {
-                
-                int voxelY = y;
-                if (voxelY == height) {
-                    if (rand() % 150 < 1) {
-                        generateTree(x, y + 1, z); // Place tree on top of grass
-                    }
-                }
+            if (rand() % 150 < 1) {
+                generateTree(x, getHeight(x, z) + 1, z); // Place tree on top of grass
             }
         }
     }
@@ -113,14 +88,32 @@ int ChunkData::getBlock(int x, int y, int z) const {
        y < 0 || y >= CHUNK_HEIGHT)
        return world->getBlock(chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z);
     
-    return voxels[x][y][z];
+    return voxels.get(x, y, z);
 }
 void ChunkData::setBlock(int x, int y, int z, int type) {
     if(x < 0 || x >= CHUNK_SIZE || 
        z < 0 || z >= CHUNK_SIZE ||
        y < 0 || y >= CHUNK_HEIGHT) return world->setBlock(chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, type);
     
-    voxels[x][y][z] = type;
+    int old = voxels.get(x, y, z);
+    if (old == type) return;
+    voxels.set(x, y, z, type);
+
+    int section = y / SECTION_SIZE;
+    if (old > 0) voxels.sectionBlockCount[section]--;
+    if (type > 0) voxels.sectionBlockCount[section]++;
+
+    // only the touched section needs a new mesh, plus any neighbour sharing the edited face
+    markSectionDirty(section);
+    if (y % SECTION_SIZE == 0) markSectionDirty(section - 1);
+    if (y % SECTION_SIZE == SECTION_SIZE - 1) markSectionDirty(section + 1);
+
+    int worldX = chunkX * CHUNK_SIZE + x;
+    int worldZ = chunkZ * CHUNK_SIZE + z;
+    if (x == 0) world->markSectionDirty(worldX - 1, y, worldZ);
+    if (x == CHUNK_SIZE - 1) world->markSectionDirty(worldX + 1, y, worldZ);
+    if (z == 0) world->markSectionDirty(worldX, y, worldZ - 1);
+    if (z == CHUNK_SIZE - 1) world->markSectionDirty(worldX, y, worldZ + 1);
 }
 
 bool ChunkData::isSolid(int x, int y, int z) const {
@@ -131,5 +124,5 @@ bool ChunkData::isSolid(int x, int y, int z) const {
         return world->getBlock(chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z) > 0;
     }
 
-    return voxels[x][y][z] > 0;
+    return voxels.get(x, y, z) > 0;
 }
@@ -1,29 +1,48 @@
 #pragma once
 #include <vector>
+#include <bitset>
 #include "GLSL.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "ChunkDims.h"
 
 class World;
 
-const int CHUNK_SIZE = 16;
-const int CHUNK_HEIGHT = 256;
+const int CHUNK_SIZE = DefaultChunkDims::SizeX;
+const int CHUNK_HEIGHT = DefaultChunkDims::SizeY;
+// chunks are split vertically into cubic sections that are meshed and drawn separately
+const int SECTION_SIZE = DefaultChunkDims::SectionSize;
+const int SECTIONS_PER_CHUNK = DefaultChunkDims::Sections;
 
 class ChunkData {
 public:
     ChunkData(int chunkX, int chunkZ, World* world, int seed);
-    glm::vec2 getChunkCoords();
+    glm::vec2 getChunkCoords() const;
     bool isSolid(int x, int y, int z) const;
     void setBlock(int x, int y, int z, int block);
     int getBlock(int x, int y, int z) const;
     void generateTrees();
     glm::vec3 origin;
+
+    const VoxelStorage<DefaultChunkDims>& getVoxels() const { return voxels; }
+    int getHeight(int x, int z) const { return heights[x * CHUNK_SIZE + z]; }
+
+    // section bookkeeping
+    bool isSectionEmpty(int section) const { return voxels.sectionBlockCount[section] == 0; }
+    bool isSectionFull(int section) const { return voxels.sectionBlockCount[section] == DefaultChunkDims::SectionVolume; }
+    bool isSectionEnclosed(int section) const;
+    void markSectionDirty(int section);
+    bool isSectionDirty(int section) const { return dirtySections.test(section); }
+    void clearSectionDirty(int section) { dirtySections.reset(section); }
+    bool hasDirtySections() const { return dirtySections.any(); }
     
 private:
     int seed;
     World* world;
     int chunkX, chunkZ;
-    std::vector<std::vector<std::vector<int>>> voxels;
+    VoxelStorage<DefaultChunkDims> voxels;
+    int heights[CHUNK_SIZE * CHUNK_SIZE];
+    std::bitset<SECTIONS_PER_CHUNK> dirtySections;
     void generateTerrain(); 
     void generateTree(int x, int y, int z);
 };
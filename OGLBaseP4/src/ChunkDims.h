@@ -0,0 +1,52 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Compile-time chunk layout. Everything that walks voxels is templated on this so
+// the index math folds to shifts/adds for power-of-two sizes.
+template <int SX, int SY, int SZ, int SECTION = 16>
+struct ChunkDims {
+    enum : int {
+        SizeX = SX,
+        SizeY = SY,
+        SizeZ = SZ,
+        SectionSize = SECTION,
+        Sections = SY / SECTION,
+        Volume = SX * SY * SZ,
+        SectionVolume = SX * SECTION * SZ
+    };
+    static_assert(SY % SECTION == 0, "chunk height must be a whole number of sections");
+
+    // y-major so that every section is one contiguous slice of the storage
+    static constexpr int index(int x, int y, int z) { return (y * SZ + z) * SX + x; }
+    static constexpr bool inBounds(int x, int y, int z) {
+        return x >= 0 && x < SX && y >= 0 && y < SY && z >= 0 && z < SZ;
+    }
+};
+
+// The layout used by the game
+typedef ChunkDims<16, 256, 16> DefaultChunkDims;
+
+typedef uint8_t BlockID;
+
+template <class Dims>
+struct VoxelStorage {
+    std::array<BlockID, Dims::Volume> blocks;
+    std::array<int, Dims::Sections> sectionBlockCount;
+
+    VoxelStorage() { blocks.fill(0); sectionBlockCount.fill(0); }
+
+    BlockID get(int x, int y, int z) const { return blocks[Dims::index(x, y, z)]; }
+    void set(int x, int y, int z, BlockID b) { blocks[Dims::index(x, y, z)] = b; }
+
+    void countSectionBlocks() {
+        for (int s = 0; s < Dims::Sections; s++) {
+            int count = 0;
+            const BlockID* section = &blocks[s * Dims::SectionVolume];
+            for (int i = 0; i < Dims::SectionVolume; i++) {
+                count += section[i] > 0;
+            }
+            sectionBlockCount[s] = count;
+        }
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include "FastNoiseLite.h"
+#include "ChunkDims.h"
+
+// Height field noise shared by chunk generation and anything else that needs the terrain surface
+inline FastNoiseLite makeTerrainNoise(int seed) {
+    FastNoiseLite noise;
+    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2S);
+    noise.SetFractalType(FastNoiseLite::FractalType_FBm);
+    // seed - 342378
+    // noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    // noise.SetFractalType(FastNoiseLite::FractalType_Ridged);
+    noise.SetFractalOctaves(3);
+    noise.SetSeed(seed);
+    return noise;
+}
+
+inline int terrainHeight(const FastNoiseLite& noise, float worldX, float worldZ) {
+    float value = noise.GetNoise(worldX, worldZ);
+    return (value + 1) * 30;
+}
+
+// Fill a chunk whose minimum corner sits at (originX, originY, originZ) in world voxels.
+// heights receives the surface height of every column (SizeX * SizeZ entries, x-major).
+template <class Dims>
+void generateTerrain(VoxelStorage<Dims>& voxels, int originX, int originY, int originZ,
+                     const FastNoiseLite& noise, int* heights) {
+    for (int x = 0; x < Dims::SizeX; x++) {
+        for (int z = 0; z < Dims::SizeZ; z++) {
+            int height = terrainHeight(noise, originX + x, originZ + z);
+            heights[x * Dims::SizeZ + z] = height;
+
+            // clamp the column to this chunk's vertical span
+            int top = height - originY;
+            if (top < 0) continue;
+            if (top >= Dims::SizeY) top = Dims::SizeY;
+            else voxels.set(x, top, z, 1); // grass top block
+
+            for (int y = 0; y < top; y++) {
+                voxels.set(x, y, z, 2); // dirt lower block
+            }
+        }
+    }
+    voxels.countSectionBlocks();
+}
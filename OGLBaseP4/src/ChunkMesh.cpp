@@ -1,49 +1,104 @@
 #include "ChunkMesh.h"
+#include "GLState.h"
 #include <glad/glad.h>
 
 ChunkMesh::ChunkMesh(ChunkData& chunkData) : chunkData(chunkData) {
 }
 
 ChunkMesh::~ChunkMesh() {
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteVertexArrays(1, &VAO);
+    for (int lod = 0; lod < LOD_LEVELS; lod++) {
+        for (SectionMesh& mesh : sections[lod]) {
+            GLState::deleteBuffers(1, &mesh.VBO);
+            GLState::deleteBuffers(1, &mesh.EBO);
+            GLState::deleteVertexArrays(1, &mesh.VAO);
+        }
+    }
 }
 
 void ChunkMesh::generateMesh() {
-    // go through voxels and add faces for visible blocks
-    for (int x = 0; x < CHUNK_SIZE; x++) {
-        for (int y = 0; y < CHUNK_HEIGHT; y++) {
-            for (int z = 0; z < CHUNK_SIZE; z++) {
-                int blockType = chunkData.getBlock(x,y,z);
-                if(chunkData.isSolid(x,y,z)){
-                    if (!chunkData.isSolid(x + 1, y, z)) addFace(x, y, z, 0, blockType); // Right
-                    if (!chunkData.isSolid(x - 1, y, z)) addFace(x, y, z, 1, blockType); // Left
-                    if (!chunkData.isSolid(x, y + 1, z)) addFace(x, y, z, 2, blockType); // Top
-                    if (!chunkData.isSolid(x, y - 1, z)) addFace(x, y, z, 3, blockType); // Bottom
-                    if (!chunkData.isSolid(x, y, z + 1)) addFace(x, y, z, 4, blockType); // Front
-                    if (!chunkData.isSolid(x, y, z - 1)) addFace(x, y, z, 5, blockType); // Back
-                }
-                
-            }
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        generateSection(s);
+    }
+    ChunkMesher::occluderHeights(chunkData.getVoxels(), OCCLUDER_CELL, occluderHeights);
+}
+
+// Coarse levels are only built the first time a chunk is drawn that far away
+void ChunkMesh::generateLOD(int lod) {
+    ChunkMesher::DownsampledVoxels cells;
+    ChunkMesher::downsample(chunkData.getVoxels(), 1 << lod, cells);
+
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        vertices.clear();
+        indices.clear();
+        if (!chunkData.isSectionEmpty(s) && !chunkData.isSectionEnclosed(s)) {
+            ChunkMesher::meshSectionLOD<DefaultChunkDims>(cells, s, vertices, indices);
         }
+        uploadSection(sections[lod][s]);
+    }
+    lodBuilt[lod] = true;
+}
+
+// remesh only the sections touched by block edits since the last update
+void ChunkMesh::update() {
+    if (!chunkData.hasDirtySections()) return;
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        if (chunkData.isSectionDirty(s)) generateSection(s);
+    }
+    ChunkMesher::occluderHeights(chunkData.getVoxels(), OCCLUDER_CELL, occluderHeights);
+    // coarse levels sample across sections, so rebuild them lazily on next use
+    for (int lod = 1; lod < LOD_LEVELS; lod++) {
+        lodBuilt[lod] = false;
+    }
+}
+
+void ChunkMesh::generateSection(int section) {
+    chunkData.clearSectionDirty(section);
+    vertices.clear();
+    indices.clear();
+
+    // all-air and fully buried sections never produce faces, so skip the scan
+    if (!chunkData.isSectionEmpty(section) && !chunkData.isSectionEnclosed(section)) {
+        // go through voxels and add faces for visible blocks
+        ChunkMesher::meshSection(chunkData.getVoxels(), section,
+            [this](int x, int y, int z) { return chunkData.isSolid(x, y, z); },
+            vertices, indices);
+    }
+
+    // face connectivity for the renderer's visibility walk
+    if (chunkData.isSectionEmpty(section)) {
+        visibility[section] = ChunkMesher::ALL_FACES_CONNECTED;
+    } else if (chunkData.isSectionFull(section)) {
+        visibility[section] = 0;
+    } else {
+        visibility[section] = ChunkMesher::sectionVisibility(chunkData.getVoxels(), section);
     }
 
-    // Generate VAO, VBO, EBO
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    uploadSection(sections[0][section]);
+}
+
+void ChunkMesh::uploadSection(SectionMesh& mesh) {
+    mesh.indexCount = indices.size();
+    if (mesh.indexCount == 0) return;
+
+    mesh.min = mesh.max = vertices[0].position;
+    for (const Vertex& v : vertices) {
+        mesh.min = glm::min(mesh.min, v.position);
+        mesh.max = glm::max(mesh.max, v.position);
+    }
 
-    //glEnable(GL_CULL_FACE);    // Enable face culling
-    //glCullFace(GL_BACK);       // Cull back faces
-    //glFrontFace(GL_CCW);
+    // Generate VAO, VBO, EBO the first time this section has geometry
+    if (mesh.VAO == 0) {
+        glGenVertexArrays(1, &mesh.VAO);
+        glGenBuffers(1, &mesh.VBO);
+        glGenBuffers(1, &mesh.EBO);
+    }
 
-    glBindVertexArray(VAO);
+    GLState::bindVertexArray(mesh.VAO);
     
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
         
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
     // Position attribute (location = 0)
@@ -58,107 +113,57 @@ void ChunkMesh::generateMesh() {
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
     glEnableVertexAttribArray(2);
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 
 }
 
 
-void ChunkMesh::render() {
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+int ChunkMesh::submit(RenderQueue& queue, int material, uint32_t model, int lod, const SectionMask& visible, GLuint condition) {
+    if (lod > 0 && !lodBuilt[lod]) generateLOD(lod);
+    glm::vec2 origin = chunkData.getChunkCoords();
+    int draws = 0;
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        const SectionMesh& mesh = sections[lod][s];
+        if (mesh.indexCount == 0 || !visible.test(s)) continue;
+        glm::vec3 center = glm::vec3(origin.x, 0, origin.y) + (mesh.min + mesh.max) * 0.5f;
+        queue.submit(RenderQueue::PASS_OPAQUE, material, mesh.VAO, mesh.indexCount, model, center, condition);
+        draws++;
+    }
+    return draws;
 }
 
-void ChunkMesh::addFace(int x, int y, int z, int faceIndex, int blockType) {
-    static const glm::vec3 positions[6][4] = {
-        // Right (+X) - Adjusted vertex order
-        { {1, 0, 0}, {1, 0, 1}, {1, 1, 1}, {1, 1, 0} },
-        // Left (-X) - Adjusted vertex order
-        { {0, 0, 1}, {0, 0, 0}, {0, 1, 0}, {0, 1, 1} },
-        // Top (+Y)
-        { {0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0} },
-        // Bottom (-Y)
-        { {0, 0, 1}, {0, 0, 0}, {1, 0, 0}, {1, 0, 1} },
-        // Front (+Z)
-        { {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1} },
-        // Back (-Z)
-        { {1, 0, 0}, {0, 0, 0}, {0, 1, 0}, {1, 1, 0} }
-    };
-
-    static const glm::vec3 normals[6] = {
-        {1, 0, 0}, {-1, 0, 0}, {0, 1, 0},
-        {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
-    };
-
-    static const glm::vec2 texCoords[4] = {
-        {0, 0}, {1, 0}, {1, 1}, {0, 1}
-    };
-
-    int atlasSize = 16; // Assume 16x16 grid in the texture atlas
-    float texSize = 1.0f / atlasSize; // Size of one tile (e.g., 1/16 = 0.0625)
-
-    glm::vec2 columnRow = getColumnRowForBlockType(blockType, faceIndex);
-
-
-    glm::vec2 texOffset(columnRow.x * texSize, columnRow.y * texSize);
-
-    int baseIndex = vertices.size();
-    for (int i = 0; i < 4; i++) {
-        glm::vec2 adjustedTexCoord = texCoords[i] * texSize + texOffset;
-        
-        vertices.push_back(Vertex(
-            glm::vec3(x, y, z) + positions[faceIndex][i],
-            normals[faceIndex],
-            adjustedTexCoord
-        ));
+SectionMask ChunkMesh::drawableSections(int lod) const {
+    SectionMask mask;
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        mask.set(s, sections[lod][s].indexCount > 0);
     }
-    
-    // Reverse winding order for +X and -X faces to fix backface culling
-    if (faceIndex == 0 || faceIndex == 1) {
-        // Triangle 1: 0 -> 2 -> 1
-        indices.push_back(baseIndex);
-        indices.push_back(baseIndex + 2);
-        indices.push_back(baseIndex + 1);
-        
-        // Triangle 2: 0 -> 3 -> 2
-        indices.push_back(baseIndex);
-        indices.push_back(baseIndex + 3);
-        indices.push_back(baseIndex + 2);
-    } else {
-        // Original winding order for other faces
-        indices.push_back(baseIndex);
-        indices.push_back(baseIndex + 1);
-        indices.push_back(baseIndex + 2);
-        
-        indices.push_back(baseIndex);
-        indices.push_back(baseIndex + 2);
-        indices.push_back(baseIndex + 3);
+    return mask;
+}
+
+SectionMask ChunkMesh::sectionsInFrustum(const Frustum& frustum) const {
+    glm::vec2 origin = chunkData.getChunkCoords();
+    SectionMask mask;
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        glm::vec3 min(origin.x, s * SECTION_SIZE, origin.y);
+        glm::vec3 max = min + glm::vec3(CHUNK_SIZE, SECTION_SIZE, CHUNK_SIZE);
+        mask.set(s, frustum.intersectsAABB(min, max));
     }
+    return mask;
 }
 
-glm::vec2 ChunkMesh::getColumnRowForBlockType(int blockType, int normal) {
-    switch (blockType) {
-        case 1: // Grass
-            switch (normal) {
-                case 2: return glm::vec2(8, 13); // Top
-                case 3: return glm::vec2(2, 15); // Bottom
-                default: return glm::vec2(3, 15); // Sides
-            }
-
-        case 2: // Dirt
-            return glm::vec2(2, 15);
-
-        case 3: // Tree trunk
-            switch (normal) {
-                case 2:
-                case 3: return glm::vec2(5, 14); // Top or Bottom
-                default: return glm::vec2(4, 14); // Sides
-            }
-
-        case 4: // Leaves
-            return glm::vec2(4, 7);
-
-        default:
-            return glm::vec2(0, 0);
+bool ChunkMesh::sectionBounds(const SectionMask& visible, glm::vec3& min, glm::vec3& max) const {
+    bool any = false;
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        const SectionMesh& mesh = sections[0][s];
+        if (mesh.indexCount == 0 || !visible.test(s)) continue;
+        min = any ? glm::min(min, mesh.min) : mesh.min;
+        max = any ? glm::max(max, mesh.max) : mesh.max;
+        any = true;
     }
+    if (!any) return false;
+
+    glm::vec2 origin = chunkData.getChunkCoords();
+    min += glm::vec3(origin.x, 0, origin.y);
+    max += glm::vec3(origin.x, 0, origin.y);
+    return true;
 }
@@ -1,22 +1,59 @@
 #pragma once
 #include <glad/glad.h>
 #include "ChunkData.h"
+#include "ChunkMesher.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
 #include "Vertex.h"
+#include <bitset>
 #include <vector>
 
+// level 0 is full detail, level n is built from a 2^n downsampled view of the chunk
+const int LOD_LEVELS = 4;
+
+// columns are grouped into cells of this many blocks a side for CPU occluders
+const int OCCLUDER_CELL = 4;
+const int OCCLUDER_CELLS = CHUNK_SIZE / OCCLUDER_CELL;
+
+// GPU buffers for one 16x16x16 slice of a chunk column
+struct SectionMesh {
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLsizei indexCount = 0;
+    glm::vec3 min, max; // chunk-local bounds of the vertices
+};
+
+typedef std::bitset<SECTIONS_PER_CHUNK> SectionMask;
+
 class ChunkMesh {
 public:
     ChunkMesh(ChunkData& chunkData);
     ~ChunkMesh();
     
     void generateMesh();
-    void render();
-    ChunkData chunkData;
+    void generateSection(int section);
+    void generateLOD(int lod);
+    void update();
+    // queues the sections set in visible and returns the number of draws submitted;
+    // model is the queue's index of the chunk's model matrix
+    int submit(RenderQueue& queue, int material, uint32_t model, int lod, const SectionMask& visible, GLuint condition = 0);
+    SectionMask drawableSections(int lod) const;
+    SectionMask sectionsInFrustum(const Frustum& frustum) const;
+    // world-space box around the full-detail geometry of the given sections, false if they have none
+    bool sectionBounds(const SectionMask& visible, glm::vec3& min, glm::vec3& max) const;
+    // true when air inside the section connects face from to face to (ChunkMesher face order)
+    bool facesConnected(int section, int from, int to) const {
+        return ChunkMesher::facesConnected(visibility[section], from, to);
+    }
+    // solid height from the bottom of each occluder cell, row-major in z
+    const int* getOccluderHeights() const { return occluderHeights; }
+    ChunkData& chunkData;
 private:
-    GLuint VAO, VBO, EBO;
+    SectionMesh sections[LOD_LEVELS][SECTIONS_PER_CHUNK];
+    ChunkMesher::SectionVisibility visibility[SECTIONS_PER_CHUNK] = {};
+    int occluderHeights[OCCLUDER_CELLS * OCCLUDER_CELLS] = {};
+    bool lodBuilt[LOD_LEVELS] = {}; // level 0 is kept current by update()
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
 
-    void addFace(int x, int y, int z, int face, int blockType);
-    glm::vec2 getColumnRowForBlockType(int blockType, int normal);
+    void uploadSection(SectionMesh& mesh);
 };
@@ -0,0 +1,100 @@
+#include "ChunkMesher.h"
+
+namespace ChunkMesher {
+
+void addFace(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+             int x, int y, int z, int faceIndex, int blockType, int size) {
+    static const glm::vec3 positions[6][4] = {
+        // Right (+X) - Adjusted vertex order
+        { {1, 0, 0}, {1, 0, 1}, {1, 1, 1}, {1, 1, 0} },
+        // Left (-X) - Adjusted vertex order
+        { {0, 0, 1}, {0, 0, 0}, {0, 1, 0}, {0, 1, 1} },
+        // Top (+Y)
+        { {0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0} },
+        // Bottom (-Y)
+        { {0, 0, 1}, {0, 0, 0}, {1, 0, 0}, {1, 0, 1} },
+        // Front (+Z)
+        { {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1} },
+        // Back (-Z)
+        { {1, 0, 0}, {0, 0, 0}, {0, 1, 0}, {1, 1, 0} }
+    };
+
+    static const glm::vec3 normals[6] = {
+        {1, 0, 0}, {-1, 0, 0}, {0, 1, 0},
+        {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+    };
+
+    static const glm::vec2 texCoords[4] = {
+        {0, 0}, {1, 0}, {1, 1}, {0, 1}
+    };
+
+    int atlasSize = 16; // Assume 16x16 grid in the texture atlas
+    float texSize = 1.0f / atlasSize; // Size of one tile (e.g., 1/16 = 0.0625)
+
+    glm::vec2 columnRow = getColumnRowForBlockType(blockType, faceIndex);
+
+
+    glm::vec2 texOffset(columnRow.x * texSize, columnRow.y * texSize);
+
+    int baseIndex = vertices.size();
+    for (int i = 0; i < 4; i++) {
+        glm::vec2 adjustedTexCoord = texCoords[i] * texSize + texOffset;
+    
+        vertices.push_back(Vertex(
+            glm::vec3(x, y, z) + positions[faceIndex][i] * float(size),
+            normals[faceIndex],
+            adjustedTexCoord
+        ));
+    }
+
+    // Reverse winding order for +X and -X faces to fix backface culling
+    if (faceIndex == 0 || faceIndex == 1) {
+        // Triangle 1: 0 -> 2 -> 1
+        indices.push_back(baseIndex);
+        indices.push_back(baseIndex + 2);
+        indices.push_back(baseIndex + 1);
+    
+        // Triangle 2: 0 -> 3 -> 2
+        indices.push_back(baseIndex);
+        indices.push_back(baseIndex + 3);
+        indices.push_back(baseIndex + 2);
+    } else {
+        // Original winding order for other faces
+        indices.push_back(baseIndex);
+        indices.push_back(baseIndex + 1);
+        indices.push_back(baseIndex + 2);
+    
+        indices.push_back(baseIndex);
+        indices.push_back(baseIndex + 2);
+        indices.push_back(baseIndex + 3);
+    }
+}
+
+glm::vec2 getColumnRowForBlockType(int blockType, int normal) {
+    switch (blockType) {
+        case 1: // Grass
+            switch (normal) {
+                case 2: return glm::vec2(8, 13); // Top
+                case 3: return glm::vec2(2, 15); // Bottom
+                default: return glm::vec2(3, 15); // Sides
+            }
+
+        case 2: // Dirt
+            return glm::vec2(2, 15);
+
+        case 3: // Tree trunk
+            switch (normal) {
+                case 2:
+                case 3: return glm::vec2(5, 14); // Top or Bottom
+                default: return glm::vec2(4, 14); // Sides
+            }
+
+        case 4: // Leaves
+            return glm::vec2(4, 7);
+
+        default:
+            return glm::vec2(0, 0);
+    }
+}
+
+}
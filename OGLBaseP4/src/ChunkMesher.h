@@ -0,0 +1,206 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <vector>
+#include "ChunkDims.h"
+#include "Vertex.h"
+
+namespace ChunkMesher {
+
+    // size > 1 emits one face spanning a size^3 cell of a downsampled chunk
+    void addFace(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                 int x, int y, int z, int faceIndex, int blockType, int size = 1);
+    glm::vec2 getColumnRowForBlockType(int blockType, int normal);
+
+    // Emit the visible faces of one section. Neighbours inside the chunk are read straight
+    // from storage; outsideSolid(x, y, z) is only asked about chunk-local coordinates that
+    // fall outside it, so the hot path never leaves the voxel array.
+    template <class Dims, class OutsideSolid>
+    void meshSection(const VoxelStorage<Dims>& voxels, int section, OutsideSolid outsideSolid,
+                     std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+        auto solid = [&](int x, int y, int z) -> bool {
+            if (Dims::inBounds(x, y, z)) return voxels.get(x, y, z) > 0;
+            return outsideSolid(x, y, z);
+        };
+
+        int minY = section * Dims::SectionSize;
+        for (int y = minY; y < minY + Dims::SectionSize; y++) {
+            for (int z = 0; z < Dims::SizeZ; z++) {
+                for (int x = 0; x < Dims::SizeX; x++) {
+                    int blockType = voxels.get(x, y, z);
+                    if (blockType == 0) continue;
+                    if (!solid(x + 1, y, z)) addFace(vertices, indices, x, y, z, 0, blockType); // Right
+                    if (!solid(x - 1, y, z)) addFace(vertices, indices, x, y, z, 1, blockType); // Left
+                    if (!solid(x, y + 1, z)) addFace(vertices, indices, x, y, z, 2, blockType); // Top
+                    if (!solid(x, y - 1, z)) addFace(vertices, indices, x, y, z, 3, blockType); // Bottom
+                    if (!solid(x, y, z + 1)) addFace(vertices, indices, x, y, z, 4, blockType); // Front
+                    if (!solid(x, y, z - 1)) addFace(vertices, indices, x, y, z, 5, blockType); // Back
+                }
+            }
+        }
+    }
+
+    // Face order used throughout: Right, Left, Top, Bottom, Front, Back; face ^ 1 is the opposite face
+    const int FACE_OFFSETS[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+
+    // Which faces of a section can see each other through connected air, stored as a 6x6
+    // bit matrix (bit a * 6 + b)
+    typedef uint64_t SectionVisibility;
+    const SectionVisibility ALL_FACES_CONNECTED = (1ull << 36) - 1;
+
+    inline bool facesConnected(SectionVisibility visibility, int a, int b) {
+        return (visibility >> (a * 6 + b)) & 1;
+    }
+
+    // Flood fill every air pocket of the section and connect all the faces it touches
+    template <class Dims>
+    SectionVisibility sectionVisibility(const VoxelStorage<Dims>& voxels, int section) {
+        const int sx = Dims::SizeX, sy = Dims::SectionSize, sz = Dims::SizeZ;
+        int minY = section * sy;
+        auto cell = [&](int x, int y, int z) { return (y * sz + z) * sx + x; };
+        auto open = [&](int x, int y, int z) { return voxels.get(x, minY + y, z) == 0; };
+
+        std::bitset<Dims::SectionVolume> visited;
+        std::vector<int> stack;
+        SectionVisibility result = 0;
+
+        for (int y = 0; y < sy; y++) {
+            for (int z = 0; z < sz; z++) {
+                for (int x = 0; x < sx; x++) {
+                    // pockets that never reach the boundary connect nothing, so only seed there
+                    bool boundary = x == 0 || x == sx - 1 || y == 0 || y == sy - 1 || z == 0 || z == sz - 1;
+                    if (!boundary || visited.test(cell(x, y, z)) || !open(x, y, z)) continue;
+
+                    int faces = 0;
+                    visited.set(cell(x, y, z));
+                    stack.push_back(cell(x, y, z));
+                    while (!stack.empty()) {
+                        int c = stack.back();
+                        stack.pop_back();
+                        int cx = c % sx, cz = (c / sx) % sz, cy = c / (sx * sz);
+                        if (cx == sx - 1) faces |= 1 << 0;
+                        if (cx == 0) faces |= 1 << 1;
+                        if (cy == sy - 1) faces |= 1 << 2;
+                        if (cy == 0) faces |= 1 << 3;
+                        if (cz == sz - 1) faces |= 1 << 4;
+                        if (cz == 0) faces |= 1 << 5;
+
+                        for (const auto& d : FACE_OFFSETS) {
+                            int nx = cx + d[0], ny = cy + d[1], nz = cz + d[2];
+                            if (nx < 0 || nx >= sx || ny < 0 || ny >= sy || nz < 0 || nz >= sz) continue;
+                            int n = cell(nx, ny, nz);
+                            if (visited.test(n) || !open(nx, ny, nz)) continue;
+                            visited.set(n);
+                            stack.push_back(n);
+                        }
+                    }
+
+                    for (int a = 0; a < 6; a++) {
+                        if (!(faces & (1 << a))) continue;
+                        for (int b = 0; b < 6; b++) {
+                            if (faces & (1 << b)) result |= SectionVisibility(1) << (a * 6 + b);
+                        }
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Conservative occluders for the CPU depth rasterizer: for each cellSize x cellSize
+    // group of columns, how many blocks up from the bottom are solid in every column
+    template <class Dims>
+    void occluderHeights(const VoxelStorage<Dims>& voxels, int cellSize, int* heights) {
+        int cellsX = Dims::SizeX / cellSize;
+        int cellsZ = Dims::SizeZ / cellSize;
+        for (int cz = 0; cz < cellsZ; cz++) {
+            for (int cx = 0; cx < cellsX; cx++) {
+                int height = Dims::SizeY;
+                for (int z = cz * cellSize; z < (cz + 1) * cellSize; z++) {
+                    for (int x = cx * cellSize; x < (cx + 1) * cellSize; x++) {
+                        int y = 0;
+                        while (y < height && voxels.get(x, y, z) > 0) y++;
+                        height = y;
+                    }
+                }
+                heights[cz * cellsX + cx] = height;
+            }
+        }
+    }
+
+    // Coarse view of a chunk where each cell stands for step^3 voxels
+    struct DownsampledVoxels {
+        int step = 1;
+        int nx = 0, ny = 0, nz = 0;
+        std::vector<BlockID> cells;
+
+        bool inBounds(int x, int y, int z) const {
+            return x >= 0 && x < nx && y >= 0 && y < ny && z >= 0 && z < nz;
+        }
+        BlockID get(int x, int y, int z) const { return cells[(y * nz + z) * nx + x]; }
+    };
+
+    // A cell is solid when at least half of its voxels are, and takes the type of its
+    // highest solid voxel so grass stays on top of distant hills.
+    template <class Dims>
+    void downsample(const VoxelStorage<Dims>& voxels, int step, DownsampledVoxels& out) {
+        out.step = step;
+        out.nx = Dims::SizeX / step;
+        out.ny = Dims::SizeY / step;
+        out.nz = Dims::SizeZ / step;
+        out.cells.assign(out.nx * out.ny * out.nz, 0);
+
+        int half = (step * step * step + 1) / 2;
+        for (int cy = 0; cy < out.ny; cy++) {
+            for (int cz = 0; cz < out.nz; cz++) {
+                for (int cx = 0; cx < out.nx; cx++) {
+                    int count = 0;
+                    int topY = -1;
+                    BlockID topType = 0;
+                    for (int y = cy * step; y < (cy + 1) * step; y++) {
+                        for (int z = cz * step; z < (cz + 1) * step; z++) {
+                            for (int x = cx * step; x < (cx + 1) * step; x++) {
+                                BlockID b = voxels.get(x, y, z);
+                                if (b == 0) continue;
+                                count++;
+                                if (y >= topY) { topY = y; topType = b; }
+                            }
+                        }
+                    }
+                    if (count >= half) out.cells[(cy * out.nz + cz) * out.nx + cx] = topType;
+                }
+            }
+        }
+    }
+
+    // Mesh one section of a downsampled chunk. Cells beyond the chunk edge count as air, so
+    // every LOD mesh carries skirt walls along its borders that hide cracks against
+    // neighbours drawn at a different level.
+    template <class Dims>
+    void meshSectionLOD(const DownsampledVoxels& cells, int section,
+                        std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+        auto solid = [&](int x, int y, int z) -> bool {
+            return cells.inBounds(x, y, z) && cells.get(x, y, z) > 0;
+        };
+
+        int step = cells.step;
+        int cellsPerSection = Dims::SectionSize / step;
+        int minY = section * cellsPerSection;
+        for (int y = minY; y < minY + cellsPerSection; y++) {
+            for (int z = 0; z < cells.nz; z++) {
+                for (int x = 0; x < cells.nx; x++) {
+                    int blockType = cells.get(x, y, z);
+                    if (blockType == 0) continue;
+                    int vx = x * step, vy = y * step, vz = z * step;
+                    if (!solid(x + 1, y, z)) addFace(vertices, indices, vx, vy, vz, 0, blockType, step); // Right
+                    if (!solid(x - 1, y, z)) addFace(vertices, indices, vx, vy, vz, 1, blockType, step); // Left
+                    if (!solid(x, y + 1, z)) addFace(vertices, indices, vx, vy, vz, 2, blockType, step); // Top
+                    if (!solid(x, y - 1, z)) addFace(vertices, indices, vx, vy, vz, 3, blockType, step); // Bottom
+                    if (!solid(x, y, z + 1)) addFace(vertices, indices, vx, vy, vz, 4, blockType, step); // Front
+                    if (!solid(x, y, z - 1)) addFace(vertices, indices, vx, vy, vz, 5, blockType, step); // Back
+                }
+            }
+        }
+    }
+
+}
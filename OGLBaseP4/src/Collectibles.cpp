@@ -0,0 +1,99 @@
+#include "Collectibles.h"
+#include <algorithm>
+#include <cmath>
+#include "ChunkData.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "Shape.h"
+
+Collectibles::~Collectibles() {
+    GLState::deleteBuffers(1, &instanceVBO);
+}
+
+void Collectibles::init(Shape& s) {
+    shape = &s;
+    capacity = 64;
+    glGenBuffers(1, &instanceVBO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+    shape->setInstanceAttribute(INSTANCE_ATTRIBUTE, instanceVBO, 4, sizeof(glm::vec4), 0);
+    dirty = true;
+}
+
+ChunkCoord Collectibles::cellOf(float x, float z) {
+    return ChunkCoord{(int)std::floor(x / CHUNK_SIZE), (int)std::floor(z / CHUNK_SIZE)};
+}
+
+void Collectibles::add(const glm::vec3& position) {
+    cells[cellOf(position.x, position.z)].push_back(position);
+    count++;
+    dirty = true;
+}
+
+void Collectibles::clear() {
+    cells.clear();
+    count = 0;
+    dirty = true;
+}
+
+int Collectibles::collect(const glm::vec3& probe, float radius, std::vector<glm::vec3>& collected) {
+    ChunkCoord lo = cellOf(probe.x - radius, probe.z - radius);
+    ChunkCoord hi = cellOf(probe.x + radius, probe.z + radius);
+    float radius2 = radius * radius;
+    int removed = 0;
+
+    for (int x = lo.x; x <= hi.x; x++) {
+        for (int z = lo.z; z <= hi.z; z++) {
+            auto cell = cells.find(ChunkCoord{x, z});
+            if (cell == cells.end()) continue;
+
+            // swap-and-pop by index, so removing never disturbs the items still to be tested
+            std::vector<glm::vec3>& items = cell->second;
+            for (size_t i = 0; i < items.size();) {
+                glm::vec3 d = items[i] - probe;
+                if (glm::dot(d, d) <= radius2) {
+                    collected.push_back(items[i]);
+                    items[i] = items.back();
+                    items.pop_back();
+                    removed++;
+                } else {
+                    i++;
+                }
+            }
+            if (items.empty()) cells.erase(cell);
+        }
+    }
+
+    if (removed > 0) {
+        count -= removed;
+        dirty = true;
+    }
+    return removed;
+}
+
+void Collectibles::upload() {
+    staging.clear();
+    center = glm::vec3(0.0f);
+    for (const auto& cell : cells) {
+        for (const glm::vec3& p : cell.second) {
+            staging.push_back(glm::vec4(p, 0.0f));
+            center += p;
+        }
+    }
+    if (!staging.empty()) center /= (float)staging.size();
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (staging.size() > capacity) {
+        capacity = std::max(staging.size(), capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(glm::vec4), staging.data());
+    dirty = false;
+}
+
+void Collectibles::submit(RenderQueue& queue, int material, const glm::mat4& model) {
+    if (count == 0) return;
+    if (dirty) upload();
+    queue.submitInstanced(RenderQueue::PASS_OPAQUE, material, shape->getVAO(), shape->getIndexCount(),
+                          (GLsizei)count, queue.addModel(model), center);
+}
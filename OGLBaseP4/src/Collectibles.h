@@ -0,0 +1,45 @@
+#pragma once
+#include <glad/glad.h>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ChunkSystem.h"
+
+class RenderQueue;
+class Shape;
+
+// Pickups (the diamonds) bucketed by the chunk column they sit in, so a pickup test only
+// looks at the cells its sphere overlaps. The whole set is one instanced draw: positions
+// live in a per-instance buffer and the lit shader's INSTANCED+SPIN variant bobs and spins them
+// from the frame time, so the buffer is only rewritten when items are added or collected.
+class Collectibles {
+public:
+    enum { INSTANCE_ATTRIBUTE = 3 }; // instancePose in lit_vert.glsl
+
+    ~Collectibles();
+    // Items are drawn with shape's mesh; its VAO gains the per-instance position attribute
+    void init(Shape& shape);
+    void add(const glm::vec3& position);
+    void clear();
+    // Remove every item whose position is within radius of center, appending it to collected.
+    // Returns how many were removed.
+    int collect(const glm::vec3& center, float radius, std::vector<glm::vec3>& collected);
+    // Queue one instanced draw of every item; model is the transform they all share
+    void submit(RenderQueue& queue, int material, const glm::mat4& model);
+
+    size_t size() const { return count; }
+
+private:
+    std::unordered_map<ChunkCoord, std::vector<glm::vec3>> cells;
+    size_t count = 0;
+
+    Shape* shape = nullptr;
+    GLuint instanceVBO = 0;
+    size_t capacity = 0; // instances the buffer has room for
+    bool dirty = false;
+    std::vector<glm::vec4> staging; // position, yaw 0
+    glm::vec3 center = glm::vec3(0.0f); // of all items, for the queue's depth sort
+
+    static ChunkCoord cellOf(float x, float z);
+    void upload();
+};
@@ -0,0 +1,51 @@
+#include "DepthSort.h"
+#include <algorithm>
+
+namespace {
+    const int RADIX = 256;
+    const float KEY_MAX = 65535.0f;
+}
+
+void DepthSort::sort(const float* depth, size_t count, std::vector<uint32_t>& order) {
+    order.resize(count);
+    if (count == 0) return;
+
+    float lo = depth[0], hi = depth[0];
+    for (size_t i = 1; i < count; i++) {
+        lo = std::min(lo, depth[i]);
+        hi = std::max(hi, depth[i]);
+    }
+    float scale = hi > lo ? KEY_MAX / (hi - lo) : 0.0f;
+
+    keys.resize(count);
+    sortedKeys.resize(count);
+    scratch.resize(count);
+    size_t low[RADIX] = {0}, high[RADIX] = {0};
+    for (size_t i = 0; i < count; i++) {
+        uint16_t key = (uint16_t)((depth[i] - lo) * scale);
+        keys[i] = key;
+        low[key & 0xff]++;
+        high[key >> 8]++;
+    }
+
+    // counts become the first output slot of each digit
+    size_t lowSum = 0, highSum = 0;
+    for (int d = 0; d < RADIX; d++) {
+        size_t l = low[d], h = high[d];
+        low[d] = lowSum;
+        high[d] = highSum;
+        lowSum += l;
+        highSum += h;
+    }
+
+    // low byte: identity order into scratch, carrying the keys along
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = low[keys[i] & 0xff]++;
+        scratch[slot] = (uint32_t)i;
+        sortedKeys[slot] = keys[i];
+    }
+    // high byte, stable, so ties keep the low byte's order
+    for (size_t i = 0; i < count; i++) {
+        order[high[sortedKeys[i] >> 8]++] = scratch[i];
+    }
+}
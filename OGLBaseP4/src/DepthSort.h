@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Back-to-front draw order for translucent particles. Depths are quantized to 16-bit keys
+// over their range in one pass, which also counts both key bytes, and an index array is then
+// ordered by two stable byte-wise radix passes. Nothing but 32-bit indices moves, so the cost
+// is linear in the count and independent of how the particle state is stored. Two depths
+// closer than 1/65536 of the range may come out in either order, which blending cannot show.
+class DepthSort {
+public:
+    // order becomes 0..count-1 sorted by ascending depth (farthest first for camera-space z)
+    void sort(const float* depth, size_t count, std::vector<uint32_t>& order);
+
+private:
+    std::vector<uint16_t> keys, sortedKeys;
+    std::vector<uint32_t> scratch;
+};
@@ -0,0 +1,33 @@
+#include "FrameUniforms.h"
+#include "GLSL.h"
+#include "GLState.h"
+#include "Program.h"
+
+static_assert(sizeof(glm::mat4) == 64 && sizeof(glm::vec4) == 16, "FrameData must match std140");
+
+FrameUniforms::~FrameUniforms() {
+    GLState::deleteBuffers(1, &ubo);
+}
+
+void FrameUniforms::init() {
+    glGenBuffers(1, &ubo);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+    CHECKED_GL_CALL(glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo));
+}
+
+void FrameUniforms::attach(Program& prog) const {
+    prog.bindUniformBlock("FrameData", BINDING);
+}
+
+void FrameUniforms::update(const glm::mat4& P, const glm::mat4& V, const glm::vec3& lightPos, float time) {
+    Block block;
+    block.P = P;
+    block.V = V;
+    block.lightPos = glm::vec4(lightPos, 1.0f);
+    block.time = glm::vec4(time, 0.0f, 0.0f, 0.0f);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+}
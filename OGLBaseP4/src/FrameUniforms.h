@@ -0,0 +1,29 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Program;
+
+// Camera and light shared by every shader through one std140 uniform block
+// ("FrameData"), uploaded once per frame instead of per program.
+class FrameUniforms {
+public:
+    enum { BINDING = 0 };
+
+    ~FrameUniforms();
+    void init();
+    // Hook a program's FrameData block up to the shared buffer
+    void attach(Program& prog) const;
+    void update(const glm::mat4& P, const glm::mat4& V, const glm::vec3& lightPos, float time);
+
+private:
+    // mirrors the std140 layout of FrameData in the shaders
+    struct Block {
+        glm::mat4 P;
+        glm::mat4 V;
+        glm::vec4 lightPos; // w unused
+        glm::vec4 time;     // x: seconds, for animation done in shaders
+    };
+
+    GLuint ubo = 0;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// View frustum planes pulled out of a projection * view matrix, for culling boxes
+class Frustum {
+public:
+    explicit Frustum(const glm::mat4& projView);
+    bool intersectsAABB(const glm::vec3& min, const glm::vec3& max) const;
+
+private:
+    glm::vec4 planes[6]; // xyz = inward normal, w = distance
+};
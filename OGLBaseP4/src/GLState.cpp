@@ -0,0 +1,256 @@
+#include "GLState.h"
+#include <map>
+#include <utility>
+
+namespace GLState
+{
+	namespace
+	{
+		// 0xFFFFFFFF never names a real object, so it marks a binding as unknown
+		const GLuint UNKNOWN = ~0u;
+
+		struct Cache
+		{
+			GLuint program;
+			GLuint vao;
+			GLuint arrayBuffer;
+			GLuint elementBuffer; // part of the VAO, reset when the VAO changes
+			GLuint uniformBuffer;
+			GLuint activeUnit;
+			GLuint texture2D[MAX_TEXTURE_UNITS];
+			GLuint textureCube[MAX_TEXTURE_UNITS];
+			int depthTest, cullFace, blend; // -1 unknown
+			int depthWrite, colorWrite;
+			GLenum depthFunc;
+			double depthNear, depthFar;
+			std::map<std::pair<GLuint, GLint>, GLint> samplers; // (program, location) -> unit
+		};
+
+		Cache cache;
+		Counters current, finished;
+
+		bool changed(GLuint &slot, GLuint value)
+		{
+			if (slot == value)
+			{
+				current.skipped++;
+				return false;
+			}
+			slot = value;
+			current.issued++;
+			return true;
+		}
+
+		bool changed(int &slot, int value)
+		{
+			if (slot == value)
+			{
+				current.skipped++;
+				return false;
+			}
+			slot = value;
+			current.issued++;
+			return true;
+		}
+
+		int *capabilitySlot(GLenum capability)
+		{
+			switch (capability)
+			{
+			case GL_DEPTH_TEST: return &cache.depthTest;
+			case GL_CULL_FACE: return &cache.cullFace;
+			case GL_BLEND: return &cache.blend;
+			default: return nullptr;
+			}
+		}
+
+		void activeTexture(GLuint unit)
+		{
+			if (changed(cache.activeUnit, unit))
+			{
+				glActiveTexture(GL_TEXTURE0 + unit);
+			}
+		}
+	}
+
+	void invalidate()
+	{
+		cache.program = cache.vao = cache.arrayBuffer = cache.elementBuffer = cache.uniformBuffer = UNKNOWN;
+		cache.activeUnit = UNKNOWN;
+		for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		{
+			cache.texture2D[i] = cache.textureCube[i] = UNKNOWN;
+		}
+		cache.depthTest = cache.cullFace = cache.blend = -1;
+		cache.depthWrite = cache.colorWrite = -1;
+		cache.depthFunc = 0;
+		cache.depthNear = cache.depthFar = -1.0;
+		cache.samplers.clear();
+	}
+
+	void beginFrame()
+	{
+		finished = current;
+		current = Counters();
+		invalidate();
+	}
+
+	const Counters &lastFrame()
+	{
+		return finished;
+	}
+
+	void useProgram(GLuint program)
+	{
+		if (changed(cache.program, program))
+		{
+			glUseProgram(program);
+		}
+	}
+
+	void bindVertexArray(GLuint vao)
+	{
+		if (changed(cache.vao, vao))
+		{
+			glBindVertexArray(vao);
+			cache.elementBuffer = UNKNOWN;
+		}
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer)
+	{
+		GLuint *slot = nullptr;
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER: slot = &cache.arrayBuffer; break;
+		case GL_ELEMENT_ARRAY_BUFFER: slot = &cache.elementBuffer; break;
+		case GL_UNIFORM_BUFFER: slot = &cache.uniformBuffer; break;
+		}
+		if (slot == nullptr)
+		{
+			current.issued++;
+			glBindBuffer(target, buffer);
+		}
+		else if (changed(*slot, buffer))
+		{
+			glBindBuffer(target, buffer);
+		}
+	}
+
+	void bindTexture(GLuint unit, GLenum target, GLuint texture)
+	{
+		GLuint *slot = nullptr;
+		if (unit < MAX_TEXTURE_UNITS)
+		{
+			if (target == GL_TEXTURE_2D) slot = &cache.texture2D[unit];
+			else if (target == GL_TEXTURE_CUBE_MAP) slot = &cache.textureCube[unit];
+		}
+		if (slot != nullptr && *slot == texture)
+		{
+			current.skipped++;
+			return;
+		}
+		activeTexture(unit);
+		if (slot != nullptr) *slot = texture;
+		current.issued++;
+		glBindTexture(target, texture);
+	}
+
+	void setSampler(GLint location, GLint unit)
+	{
+		if (location < 0) return;
+		GLint &slot = cache.samplers.insert(std::make_pair(std::make_pair(cache.program, location), -1)).first->second;
+		if (cache.program != UNKNOWN && slot == unit)
+		{
+			current.skipped++;
+			return;
+		}
+		slot = unit;
+		current.issued++;
+		glUniform1i(location, unit);
+	}
+
+	void deleteTextures(GLsizei n, const GLuint *textures)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+			{
+				if (cache.texture2D[unit] == textures[i]) cache.texture2D[unit] = 0;
+				if (cache.textureCube[unit] == textures[i]) cache.textureCube[unit] = 0;
+			}
+		}
+		glDeleteTextures(n, textures);
+	}
+
+	void deleteBuffers(GLsizei n, const GLuint *buffers)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (cache.arrayBuffer == buffers[i]) cache.arrayBuffer = 0;
+			if (cache.elementBuffer == buffers[i]) cache.elementBuffer = 0;
+			if (cache.uniformBuffer == buffers[i]) cache.uniformBuffer = 0;
+		}
+		glDeleteBuffers(n, buffers);
+	}
+
+	void deleteVertexArrays(GLsizei n, const GLuint *arrays)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (cache.vao == arrays[i])
+			{
+				cache.vao = 0;
+				cache.elementBuffer = UNKNOWN;
+			}
+		}
+		glDeleteVertexArrays(n, arrays);
+	}
+
+	void setEnabled(GLenum capability, bool enabled)
+	{
+		int *slot = capabilitySlot(capability);
+		if (slot != nullptr && !changed(*slot, enabled ? 1 : 0)) return;
+		if (slot == nullptr) current.issued++;
+		if (enabled) glEnable(capability);
+		else glDisable(capability);
+	}
+
+	void depthMask(bool write)
+	{
+		if (changed(cache.depthWrite, write ? 1 : 0))
+		{
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+		}
+	}
+
+	void depthFunc(GLenum func)
+	{
+		if (changed(cache.depthFunc, func))
+		{
+			glDepthFunc(func);
+		}
+	}
+
+	void depthRange(double nearVal, double farVal)
+	{
+		if (cache.depthNear == nearVal && cache.depthFar == farVal)
+		{
+			current.skipped++;
+			return;
+		}
+		cache.depthNear = nearVal;
+		cache.depthFar = farVal;
+		current.issued++;
+		glDepthRange(nearVal, farVal);
+	}
+
+	void colorMask(bool write)
+	{
+		if (changed(cache.colorWrite, write ? 1 : 0))
+		{
+			GLboolean mask = write ? GL_TRUE : GL_FALSE;
+			glColorMask(mask, mask, mask, mask);
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef LAB471_GLSTATE_H_INCLUDED
+#define LAB471_GLSTATE_H_INCLUDED
+
+#include <glad/glad.h>
+
+// Thin cache in front of the GL binding and fixed-function calls used by the renderer.
+// Calls that would not change the current state are skipped and counted.
+namespace GLState
+{
+	const int MAX_TEXTURE_UNITS = 16;
+
+	struct Counters
+	{
+		int issued = 0;
+		int skipped = 0;
+	};
+
+	// Forget everything so the next call of each kind is issued; code that talks to GL
+	// directly (e.g. the ImGui backend) can leave the real state different from the cache
+	void invalidate();
+	// Start a new frame's counters, keeping the finished frame's for display
+	void beginFrame();
+	const Counters &lastFrame();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+	// Sampler uniform of the current program
+	void setSampler(GLint location, GLint unit);
+
+	// Deleting a bound object resets its binding to 0, so deletes go through here too
+	void deleteTextures(GLsizei n, const GLuint *textures);
+	void deleteBuffers(GLsizei n, const GLuint *buffers);
+	void deleteVertexArrays(GLsizei n, const GLuint *arrays);
+
+	void setEnabled(GLenum capability, bool enabled);
+	void depthMask(bool write);
+	void depthFunc(GLenum func);
+	void depthRange(double nearVal, double farVal);
+	void colorMask(bool write);
+}
+
+#endif // LAB471_GLSTATE_H_INCLUDED
@@ -0,0 +1,115 @@
+#include "GpuParticles.h"
+#include <cstddef>
+#include <cstdint>
+#include <glm/gtc/type_ptr.hpp>
+#include "GLSL.h"
+#include "GLState.h"
+#include "Program.h"
+
+namespace {
+    // Interleaved state exactly as the update shader's outputs are captured
+    struct ParticleState {
+        glm::vec3 position;
+        float age;
+        glm::vec3 velocity;
+        float life;
+        glm::vec4 color;
+        uint32_t seed;
+    };
+    static_assert(sizeof(ParticleState) == 13 * sizeof(float), "transform feedback writes the state tightly packed");
+
+    void stateAttribute(GLuint location, int components, size_t offset) {
+        glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, sizeof(ParticleState), (const void*)offset);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+std::vector<std::string> GpuParticles::feedbackVaryings() {
+    return {"outPosition", "outAge", "outVelocity", "outLife", "outColor", "outSeed"};
+}
+
+GpuParticles::~GpuParticles() {
+    GLState::deleteVertexArrays(2, updateVAO);
+    GLState::deleteVertexArrays(2, drawVAO);
+    GLState::deleteBuffers(2, buffers);
+}
+
+void GpuParticles::init(std::shared_ptr<Program> update, int particles) {
+    program = update;
+    count = particles;
+    auto uniform = [this](const char* name) {
+        program->addUniform(name);
+        return program->getUniform(name);
+    };
+    sourceLoc = uniform("source");
+    stepLoc = uniform("h");
+    restartLoc = uniform("restart");
+    velocityMinLoc = uniform("velocityMin");
+    velocityMaxLoc = uniform("velocityMax");
+    lifeRangeLoc = uniform("lifeRange");
+    colorMinLoc = uniform("colorMin");
+    colorMaxLoc = uniform("colorMax");
+
+    // everything starts dead with its own seed and is born on the first step
+    std::vector<ParticleState> initial(count);
+    for (int i = 0; i < count; i++) {
+        initial[i] = ParticleState{glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 0.0f, glm::vec4(0.0f), 2654435761u * (uint32_t)i + 1u};
+    }
+
+    glGenBuffers(2, buffers);
+    glGenVertexArrays(2, updateVAO);
+    glGenVertexArrays(2, drawVAO);
+    for (int i = 0; i < 2; i++) {
+        GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(ParticleState), initial.data(), GL_DYNAMIC_COPY);
+
+        GLState::bindVertexArray(updateVAO[i]);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        stateAttribute(0, 3, offsetof(ParticleState, position));
+        stateAttribute(1, 1, offsetof(ParticleState, age));
+        stateAttribute(2, 3, offsetof(ParticleState, velocity));
+        stateAttribute(3, 1, offsetof(ParticleState, life));
+        glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(ParticleState), (const void*)offsetof(ParticleState, seed));
+        glEnableVertexAttribArray(4);
+
+        // the particle program's vertPos and vertCol, one point instance per particle
+        GLState::bindVertexArray(drawVAO[i]);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        stateAttribute(0, 3, offsetof(ParticleState, position));
+        stateAttribute(1, 4, offsetof(ParticleState, color));
+        glVertexAttribDivisor(0, 1);
+        glVertexAttribDivisor(1, 1);
+    }
+    GLState::bindVertexArray(0);
+}
+
+void GpuParticles::update() {
+    if (count == 0) return;
+    int next = 1 - current;
+
+    program->bind();
+    glUniform3fv(sourceLoc, 1, glm::value_ptr(emitter.source));
+    glUniform1f(stepLoc, emitter.step);
+    glUniform1i(restartLoc, restart ? 1 : 0);
+    glUniform3fv(velocityMinLoc, 1, glm::value_ptr(emitter.velocityMin));
+    glUniform3fv(velocityMaxLoc, 1, glm::value_ptr(emitter.velocityMax));
+    glUniform2f(lifeRangeLoc, emitter.lifeRange.x, emitter.lifeRange.y);
+    glUniform3fv(colorMinLoc, 1, glm::value_ptr(emitter.colorMin));
+    glUniform3fv(colorMaxLoc, 1, glm::value_ptr(emitter.colorMax));
+    restart = false;
+
+    GLState::setEnabled(GL_RASTERIZER_DISCARD, true);
+    GLState::bindVertexArray(updateVAO[current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    GLState::setEnabled(GL_RASTERIZER_DISCARD, false);
+    current = next;
+}
+
+void GpuParticles::draw() const {
+    GLState::bindVertexArray(drawVAO[current]);
+    glDrawArraysInstanced(GL_POINTS, 0, 1, count);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Program;
+
+// Particles simulated entirely on the GPU with transform feedback (GL 3.3). Two buffers hold
+// the particle state; each step draws one buffer as points through the update program, with
+// rasterization discarded, and captures the new state into the other. Dead particles are
+// reborn from their own seed in the shader, so the CPU only sets the emitter uniforms and
+// the particle count costs it nothing. Drawing reads position and colour straight from the
+// latest state buffer, in the layout the CPU particle program expects.
+class GpuParticles {
+public:
+    struct Emitter {
+        glm::vec3 source = glm::vec3(0.0f);
+        glm::vec3 velocityMin = glm::vec3(-0.27f, -0.1f, -0.3f);
+        glm::vec3 velocityMax = glm::vec3(0.3f, 0.9f, 0.27f);
+        glm::vec2 lifeRange = glm::vec2(100.0f, 200.0f);
+        glm::vec3 colorMin = glm::vec3(0.85f, 0.6f, 0.6f);
+        glm::vec3 colorMax = glm::vec3(0.95f, 0.8f, 0.8f);
+        float step = 0.01f;
+    };
+
+    Emitter emitter;
+
+    ~GpuParticles();
+    // Outputs of particle_update_vert.glsl in the order they are captured
+    static std::vector<std::string> feedbackVaryings();
+    // update is the linked program built from particle_update_*.glsl with feedbackVaryings()
+    void init(std::shared_ptr<Program> update, int count);
+
+    // Every particle is reborn on the next step
+    void reset() { restart = true; }
+    // One simulation step on the GPU
+    void update();
+    // Instanced points from the latest state, with the particle program bound
+    void draw() const;
+    int size() const { return count; }
+
+private:
+    std::shared_ptr<Program> program;
+    GLuint buffers[2] = {0, 0};
+    GLuint updateVAO[2] = {0, 0}; // reads buffers[i] as update input
+    GLuint drawVAO[2] = {0, 0};   // reads buffers[i] as point instances
+    int current = 0;              // buffer with the latest state
+    int count = 0;
+    bool restart = true;
+    GLint sourceLoc = -1, stepLoc = -1, restartLoc = -1, velocityMinLoc = -1, velocityMaxLoc = -1,
+          lifeRangeLoc = -1, colorMinLoc = -1, colorMaxLoc = -1;
+};
@@ -0,0 +1,172 @@
+#include "Horizon.h"
+#include <cmath>
+#include "ChunkGenerator.h"
+#include "GLSL.h"
+#include "GLState.h"
+#include "Program.h"
+
+Horizon::~Horizon() {
+    for (auto& pair : tiles) {
+        GLState::deleteTextures(1, &pair.second.heightTex);
+        GLState::deleteTextures(1, &pair.second.colorTex);
+    }
+    for (Grid& grid : grids) {
+        GLState::deleteBuffers(1, &grid.VBO);
+        GLState::deleteBuffers(1, &grid.EBO);
+        GLState::deleteVertexArrays(1, &grid.VAO);
+    }
+}
+
+void Horizon::init(int seed) {
+    noise = makeTerrainNoise(seed);
+    heights.resize(TILE_TEXELS * TILE_TEXELS);
+    colors.resize(TILE_TEXELS * TILE_TEXELS * 4);
+    for (int level = 0; level < GRID_LEVELS; level++) {
+        buildGrid(((TILE_TEXELS - 1) >> level) + 1, grids[level]);
+    }
+}
+
+ChunkCoord Horizon::tileAt(const glm::vec3& pos) const {
+    return {
+        static_cast<int>(floor(pos.x / TILE_WORLD)),
+        static_cast<int>(floor(pos.z / TILE_WORLD))
+    };
+}
+
+void Horizon::update(const glm::vec3& eye, int budget) {
+    ChunkCoord center = tileAt(eye);
+
+    // drop tiles that fell well behind the ring
+    for (auto it = tiles.begin(); it != tiles.end(); ) {
+        if (abs(it->first.x - center.x) > TILE_RADIUS + 1 || abs(it->first.z - center.z) > TILE_RADIUS + 1) {
+            GLState::deleteTextures(1, &it->second.heightTex);
+            GLState::deleteTextures(1, &it->second.colorTex);
+            it = tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (int dx = -TILE_RADIUS; dx <= TILE_RADIUS && budget != 0; dx++) {
+        for (int dz = -TILE_RADIUS; dz <= TILE_RADIUS && budget != 0; dz++) {
+            ChunkCoord coord = {center.x + dx, center.z + dz};
+            if (tiles.find(coord) != tiles.end()) continue;
+            buildTile(coord, tiles[coord]);
+            budget--;
+        }
+    }
+}
+
+void Horizon::buildTile(const ChunkCoord& coord, Tile& tile) {
+    float originX = coord.x * TILE_WORLD;
+    float originZ = coord.z * TILE_WORLD;
+
+    for (int j = 0; j < TILE_TEXELS; j++) {
+        for (int i = 0; i < TILE_TEXELS; i++) {
+            // +1 puts the surface on top of the grass block, like the chunk meshes
+            float h = terrainHeight(noise, originX + i * SAMPLE_SPACING, originZ + j * SAMPLE_SPACING) + 1;
+            heights[j * TILE_TEXELS + i] = h;
+
+            // grass that gets lighter with altitude, fading to dirt in the lowest valleys
+            float t = glm::clamp(h / 60.0f, 0.0f, 1.0f);
+            glm::vec3 dirt(0.45f, 0.32f, 0.2f);
+            glm::vec3 grass(0.3f + 0.15f * t, 0.5f + 0.2f * t, 0.18f + 0.05f * t);
+            glm::vec3 c = t < 0.1f ? glm::mix(dirt, grass, t / 0.1f) : grass;
+            unsigned char* texel = &colors[(j * TILE_TEXELS + i) * 4];
+            texel[0] = (unsigned char)(c.r * 255);
+            texel[1] = (unsigned char)(c.g * 255);
+            texel[2] = (unsigned char)(c.b * 255);
+            texel[3] = 255;
+        }
+    }
+
+    glGenTextures(1, &tile.heightTex);
+    GLState::bindTexture(0, GL_TEXTURE_2D, tile.heightTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, TILE_TEXELS, TILE_TEXELS, 0, GL_RED, GL_FLOAT, heights.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+
+    glGenTextures(1, &tile.colorTex);
+    GLState::bindTexture(0, GL_TEXTURE_2D, tile.colorTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TILE_TEXELS, TILE_TEXELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+// Unit grid over a tile plus an outer ring of skirt vertices (y = 1) that the vertex
+// shader pulls down, so coarse and fine neighbours never show a gap.
+void Horizon::buildGrid(int vertsPerSide, Grid& grid) {
+    int n = vertsPerSide + 2;
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            int gi = glm::clamp(i - 1, 0, vertsPerSide - 1);
+            int gj = glm::clamp(j - 1, 0, vertsPerSide - 1);
+            bool skirt = i == 0 || j == 0 || i == n - 1 || j == n - 1;
+            verts.push_back(gi / float(vertsPerSide - 1));
+            verts.push_back(skirt ? 1.0f : 0.0f);
+            verts.push_back(gj / float(vertsPerSide - 1));
+        }
+    }
+    for (int j = 0; j < n - 1; j++) {
+        for (int i = 0; i < n - 1; i++) {
+            unsigned int v = j * n + i;
+            indices.push_back(v);
+            indices.push_back(v + n);
+            indices.push_back(v + 1);
+            indices.push_back(v + 1);
+            indices.push_back(v + n);
+            indices.push_back(v + n + 1);
+        }
+    }
+    grid.indexCount = indices.size();
+
+    glGenVertexArrays(1, &grid.VAO);
+    glGenBuffers(1, &grid.VBO);
+    glGenBuffers(1, &grid.EBO);
+    GLState::bindVertexArray(grid.VAO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, grid.VBO);
+    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    GLState::bindVertexArray(0);
+}
+
+void Horizon::draw(const std::shared_ptr<Program> prog, const glm::vec3& eye) {
+    ChunkCoord center = tileAt(eye);
+
+    GLState::setSampler(prog->getUniform(UNIFORM_HEIGHT_MAP), 0);
+    GLState::setSampler(prog->getUniform(UNIFORM_COLOR_MAP), 1);
+    glUniform1f(prog->getUniform(UNIFORM_TILE_SIZE), (float)TILE_WORLD);
+    glUniform1f(prog->getUniform(UNIFORM_TEXELS), (float)TILE_TEXELS);
+
+    for (auto& pair : tiles) {
+        const ChunkCoord& coord = pair.first;
+        int ring = glm::max(abs(coord.x - center.x), abs(coord.z - center.z));
+        if (ring > TILE_RADIUS) continue;
+
+        // coarser grids and prefiltered heights further out
+        int level = ring == 0 ? 0 : (ring <= 2 ? 1 : 2);
+        const Grid& grid = grids[level];
+
+        GLState::bindTexture(0, GL_TEXTURE_2D, pair.second.heightTex);
+        GLState::bindTexture(1, GL_TEXTURE_2D, pair.second.colorTex);
+        glUniform2f(prog->getUniform(UNIFORM_TILE_ORIGIN), (float)coord.x * TILE_WORLD, (float)coord.z * TILE_WORLD);
+        glUniform1f(prog->getUniform(UNIFORM_MIP_LEVEL), (float)level);
+
+        GLState::bindVertexArray(grid.VAO);
+        glDrawElements(GL_TRIANGLES, grid.indexCount, GL_UNSIGNED_INT, 0);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ChunkSystem.h"
+#include "FastNoiseLite.h"
+
+class Program;
+
+// Far terrain drawn past the loaded chunks: a ring of heightmap tiles sampled from the
+// same noise as chunk generation and rendered as low-poly grids.
+class Horizon {
+public:
+    static const int TILE_TEXELS = 65;       // samples per tile side, edges shared with neighbours
+    static const int SAMPLE_SPACING = 8;     // blocks between samples
+    static const int TILE_WORLD = (TILE_TEXELS - 1) * SAMPLE_SPACING;
+    static const int TILE_RADIUS = 4;        // tiles drawn on each side of the camera tile
+    static const int GRID_LEVELS = 3;        // 65, 33 and 17 vertices per tile side
+
+    ~Horizon();
+    void init(int seed);
+    // Generate missing tiles around the camera, at most budget per call (-1 = all)
+    void update(const glm::vec3& eye, int budget = 2);
+    void draw(const std::shared_ptr<Program> prog, const glm::vec3& eye);
+
+private:
+    struct Tile {
+        GLuint heightTex = 0;
+        GLuint colorTex = 0;
+    };
+    struct Grid {
+        GLuint VAO = 0, VBO = 0, EBO = 0;
+        GLsizei indexCount = 0;
+    };
+
+    FastNoiseLite noise;
+    std::unordered_map<ChunkCoord, Tile> tiles;
+    Grid grids[GRID_LEVELS];
+    std::vector<float> heights;
+    std::vector<unsigned char> colors;
+
+    ChunkCoord tileAt(const glm::vec3& pos) const;
+    void buildTile(const ChunkCoord& coord, Tile& tile);
+    void buildGrid(int vertsPerSide, Grid& grid);
+};
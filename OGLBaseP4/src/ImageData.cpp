@@ -0,0 +1,291 @@
+#include "ImageData.h"
+#include "AssetArchive.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "stb_image.h"
+
+using namespace std;
+
+namespace
+{
+	const uint32_t BAKED_MAGIC = 0x50494D54; // "TMIP"
+	const uint32_t BAKED_VERSION = 1;
+
+	struct BakedHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t channels;
+		uint32_t bottomUp;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levels;
+	};
+
+	size_t levelSize(int width, int height, int channels)
+	{
+		return (size_t)width * height * channels;
+	}
+
+	// 8-bit sRGB to linear, for every value
+	struct SrgbTable
+	{
+		float linear[256];
+		SrgbTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				linear[i] = c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	const float *srgbToLinear()
+	{
+		static const SrgbTable table;
+		return table.linear;
+	}
+
+	unsigned char linearToSrgb(float c)
+	{
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+		return (unsigned char)min(255.0f, max(0.0f, c * 255.0f + 0.5f));
+	}
+
+	// Whether the baked file at baked was written after source last changed; true without a source
+	bool bakedIsCurrent(const string &baked, const string &source)
+	{
+		AssetArchive::Stamp bakedStamp, sourceStamp;
+		if (!AssetArchive::stamp(baked, bakedStamp))
+		{
+			return false;
+		}
+		return !AssetArchive::stamp(source, sourceStamp) || bakedStamp.time >= sourceStamp.time;
+	}
+
+	// Fill out's levels from the header at the front of data; level offsets are from data
+	bool parseBaked(const unsigned char *data, size_t size, ImageData &out)
+	{
+		BakedHeader header;
+		if (size < sizeof(header))
+		{
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (header.magic != BAKED_MAGIC || header.version != BAKED_VERSION || header.levels == 0)
+		{
+			return false;
+		}
+
+		out.channels = header.channels;
+		out.bottomUp = header.bottomUp != 0;
+		out.levels.clear();
+		size_t offset = sizeof(header);
+		int w = header.width, h = header.height;
+		for (uint32_t i = 0; i < header.levels; i++)
+		{
+			out.levels.push_back({w, h, offset});
+			offset += levelSize(w, h, out.channels);
+			w = max(1, w / 2);
+			h = max(1, h / 2);
+		}
+		if (offset != size)
+		{
+			out.levels.clear();
+			return false;
+		}
+		return true;
+	}
+}
+
+void ImageData::flipRows()
+{
+	if (external)
+	{
+		size_t end = levels.back().offset + levelBytes((int)levels.size() - 1);
+		pixels.assign(external, external + end);
+		external = nullptr;
+	}
+
+	vector<unsigned char> row;
+	for (const Level &l : levels)
+	{
+		size_t rowSize = (size_t)l.width * channels;
+		row.resize(rowSize);
+		unsigned char *base = pixels.data() + l.offset;
+		for (int i = 0; i < l.height / 2; i++)
+		{
+			unsigned char *row1 = base + i * rowSize;
+			unsigned char *row2 = base + (l.height - i - 1) * rowSize;
+			memcpy(row.data(), row1, rowSize);
+			memcpy(row1, row2, rowSize);
+			memcpy(row2, row.data(), rowSize);
+		}
+	}
+	bottomUp = !bottomUp;
+}
+
+void ImageData::buildMips()
+{
+	if (levels.empty())
+	{
+		return;
+	}
+	// restart from a tightly packed copy of level 0
+	vector<unsigned char> base(level(0), level(0) + levelBytes(0));
+	pixels.swap(base);
+	external = nullptr;
+	levels.resize(1);
+	levels[0].offset = 0;
+	const float *linear = srgbToLinear();
+	int colorChannels = srgb() ? 3 : 0;
+
+	while (levels.back().width > 1 || levels.back().height > 1)
+	{
+		Level src = levels.back();
+		Level dst;
+		dst.width = max(1, src.width / 2);
+		dst.height = max(1, src.height / 2);
+		dst.offset = pixels.size();
+		pixels.resize(dst.offset + levelSize(dst.width, dst.height, channels));
+
+		const unsigned char *in = pixels.data() + src.offset;
+		unsigned char *out = pixels.data() + dst.offset;
+		// 2x2 box filter; a side that is already 1 texel reuses its only row or column
+		for (int y = 0; y < dst.height; y++)
+		{
+			int y0 = min(2 * y, src.height - 1), y1 = min(2 * y + 1, src.height - 1);
+			for (int x = 0; x < dst.width; x++)
+			{
+				int x0 = min(2 * x, src.width - 1), x1 = min(2 * x + 1, src.width - 1);
+				for (int c = 0; c < colorChannels; c++)
+				{
+					float sum = linear[in[(y0 * src.width + x0) * channels + c]] + linear[in[(y0 * src.width + x1) * channels + c]] +
+						linear[in[(y1 * src.width + x0) * channels + c]] + linear[in[(y1 * src.width + x1) * channels + c]];
+					out[(y * dst.width + x) * channels + c] = linearToSrgb(sum * 0.25f);
+				}
+				for (int c = colorChannels; c < channels; c++)
+				{
+					int sum = in[(y0 * src.width + x0) * channels + c] + in[(y0 * src.width + x1) * channels + c] +
+						in[(y1 * src.width + x0) * channels + c] + in[(y1 * src.width + x1) * channels + c];
+					out[(y * dst.width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		levels.push_back(dst);
+	}
+}
+
+string bakedPath(const string &source)
+{
+	return source + ".mip";
+}
+
+bool readBaked(const string &path, ImageData &out)
+{
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// one read for the whole file; the levels are then offsets into it, past the header
+	file.seekg(0, ios::end);
+	size_t size = (size_t)file.tellg();
+	file.seekg(0, ios::beg);
+	vector<unsigned char> data(size);
+	if (!file.read((char *)data.data(), size) || !parseBaked(data.data(), size, out))
+	{
+		cerr << path << " is not a baked texture" << endl;
+		return false;
+	}
+	out.pixels.swap(data);
+	out.external = nullptr;
+	return true;
+}
+
+bool viewBaked(const unsigned char *data, size_t size, ImageData &out)
+{
+	if (!parseBaked(data, size, out))
+	{
+		return false;
+	}
+	out.pixels.clear();
+	out.external = data;
+	return true;
+}
+
+bool encodeBaked(const ImageData &image, vector<unsigned char> &out)
+{
+	out.clear();
+	if (image.empty())
+	{
+		return false;
+	}
+	BakedHeader header = { BAKED_MAGIC, BAKED_VERSION, (uint32_t)image.channels, image.bottomUp ? 1u : 0u,
+		(uint32_t)image.width(), (uint32_t)image.height(), (uint32_t)image.levels.size() };
+	const unsigned char *bytes = (const unsigned char *)&header;
+	out.insert(out.end(), bytes, bytes + sizeof(header));
+	for (int i = 0; i < (int)image.levels.size(); i++)
+	{
+		out.insert(out.end(), image.level(i), image.level(i) + image.levelBytes(i));
+	}
+	return true;
+}
+
+bool writeBaked(const string &path, const ImageData &image)
+{
+	vector<unsigned char> data;
+	if (!encodeBaked(image, data))
+	{
+		return false;
+	}
+	ofstream file(path, ios::binary | ios::trunc);
+	file.write((const char *)data.data(), data.size());
+	return (bool)file;
+}
+
+bool decodeImage(const string &filename, ImageData &out)
+{
+	// stb's vertical flip is a global setting shared by every thread, so rows are flipped by hand
+	int w, h, ncomps;
+	unsigned char *data = stbi_load(filename.c_str(), &w, &h, &ncomps, 0);
+	if (!data)
+	{
+		cerr << filename << " not found" << endl;
+		return false;
+	}
+
+	out.channels = ncomps;
+	out.bottomUp = false;
+	out.external = nullptr;
+	out.levels.assign(1, {w, h, 0});
+	out.pixels.assign(data, data + levelSize(w, h, ncomps));
+	stbi_image_free(data);
+	return true;
+}
+
+bool loadImage(const string &filename, bool bottomUp, ImageData &out)
+{
+	AssetArchive::Blob blob;
+	bool found = AssetArchive::find(filename, AssetArchive::ASSET_IMAGE, blob) && viewBaked(blob.data, blob.size, out);
+	if (!found)
+	{
+		string baked = bakedPath(filename);
+		found = bakedIsCurrent(baked, filename) && readBaked(baked, out);
+	}
+	if (!found && !decodeImage(filename, out))
+	{
+		return false;
+	}
+	if (out.bottomUp != bottomUp)
+	{
+		out.flipRows();
+	}
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef LAB471_IMAGEDATA_H_INCLUDED
+#define LAB471_IMAGEDATA_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+// Decoded 8-bit image with an optional mip chain, kept in CPU memory so it can be produced
+// on a worker thread and handed to the GL thread for upload. Contains no GL calls.
+struct ImageData
+{
+	struct Level
+	{
+		int width;
+		int height;
+		size_t offset; // into pixels
+	};
+
+	int channels = 0;
+	bool bottomUp = false; // first row is the bottom of the image, as glTexImage2D expects
+	std::vector<Level> levels;
+	std::vector<unsigned char> pixels;
+	const unsigned char *external = nullptr; // when set, levels index this (e.g. a mapped archive) instead of pixels
+
+	bool empty() const { return levels.empty(); }
+	int width() const { return levels.empty() ? 0 : levels[0].width; }
+	int height() const { return levels.empty() ? 0 : levels[0].height; }
+	const unsigned char *level(int i) const { return (external ? external : pixels.data()) + levels[i].offset; }
+	size_t levelBytes(int i) const { return (size_t)levels[i].width * levels[i].height * channels; }
+
+	// Texture uploads RGBA images as GL_SRGB_ALPHA, so their colour channels are sRGB encoded
+	bool srgb() const { return channels == 4; }
+
+	// Reverse the row order of every level, copying external pixels first
+	void flipRows();
+	// Replace any mips with a box-filtered chain down to 1x1, averaging sRGB colour in linear space
+	void buildMips();
+};
+
+// Baked textures live next to their source as "<source>.mip": a small header followed by
+// every level's pixels exactly as they are uploaded.
+std::string bakedPath(const std::string &source);
+bool readBaked(const std::string &path, ImageData &out);
+bool writeBaked(const std::string &path, const ImageData &image);
+// The bytes writeBaked puts in the file
+bool encodeBaked(const ImageData &image, std::vector<unsigned char> &out);
+// Point out at baked bytes already in memory without copying them
+bool viewBaked(const unsigned char *data, size_t size, ImageData &out);
+
+// Decode a JPG/PNG/BMP with stb_image; a single level in the file's top-down row order
+bool decodeImage(const std::string &filename, ImageData &out);
+// The archive entry or baked file when there is one, otherwise the decoded source, with rows in
+// the requested order. A baked file older than its source is ignored.
+bool loadImage(const std::string &filename, bool bottomUp, ImageData &out);
+
+#endif // LAB471_IMAGEDATA_H_INCLUDED
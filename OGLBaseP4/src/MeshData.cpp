@@ -0,0 +1,430 @@
+#include "MeshData.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+void buildMeshData(const tinyobj::shape_t &shape, MeshData &out, bool optimize)
+{
+	const vector<float> &posBuf = shape.mesh.positions;
+	const vector<float> &norBuf = shape.mesh.normals;
+	const vector<float> &texBuf = shape.mesh.texcoords;
+	size_t count = posBuf.size() / 3;
+
+	out.indices = shape.mesh.indices;
+	out.vertices.assign(count, MeshVertex());
+	for (size_t v = 0; v < count; v++)
+	{
+		MeshVertex &vert = out.vertices[v];
+		memcpy(vert.position, &posBuf[3 * v], sizeof(vert.position));
+		if (norBuf.size() == posBuf.size())
+		{
+			memcpy(vert.normal, &norBuf[3 * v], sizeof(vert.normal));
+		}
+		else
+		{
+			vert.normal[0] = vert.normal[1] = vert.normal[2] = 0.0f;
+		}
+		if (texBuf.size() / 2 == count)
+		{
+			memcpy(vert.texCoord, &texBuf[2 * v], sizeof(vert.texCoord));
+		}
+		else
+		{
+			vert.texCoord[0] = vert.texCoord[1] = 0.0f;
+		}
+	}
+
+	if (norBuf.size() != posBuf.size())
+	{
+		// add each face normal to its vertices, then normalize
+		for (size_t i = 0; i + 2 < out.indices.size(); i += 3)
+		{
+			MeshVertex *tri[3] = { &out.vertices[out.indices[i]], &out.vertices[out.indices[i + 1]], &out.vertices[out.indices[i + 2]] };
+			glm::vec3 v0(tri[0]->position[0], tri[0]->position[1], tri[0]->position[2]);
+			glm::vec3 v1(tri[1]->position[0], tri[1]->position[1], tri[1]->position[2]);
+			glm::vec3 v2(tri[2]->position[0], tri[2]->position[1], tri[2]->position[2]);
+			glm::vec3 faceNormal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+			for (MeshVertex *vert : tri)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					vert->normal[j] += faceNormal[j];
+				}
+			}
+		}
+		for (MeshVertex &vert : out.vertices)
+		{
+			glm::vec3 normal = glm::normalize(glm::vec3(vert.normal[0], vert.normal[1], vert.normal[2]));
+			vert.normal[0] = normal.x;
+			vert.normal[1] = normal.y;
+			vert.normal[2] = normal.z;
+		}
+	}
+
+	if (optimize)
+	{
+		optimizeMesh(out);
+	}
+	out.bounds = measureMesh(out.vertices.data(), out.vertices.size());
+}
+
+MeshBounds measureMesh(const MeshVertex *vertices, size_t count)
+{
+	MeshBounds bounds;
+	bounds.min = bounds.max = bounds.sphereCenter = glm::vec3(0.0f);
+	bounds.sphereRadius = 0.0f;
+	if (count == 0)
+	{
+		return bounds;
+	}
+
+	bounds.min = bounds.max = glm::vec3(vertices[0].position[0], vertices[0].position[1], vertices[0].position[2]);
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 p(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]);
+		bounds.min = glm::min(bounds.min, p);
+		bounds.max = glm::max(bounds.max, p);
+		bounds.sphereCenter += p;
+	}
+	bounds.sphereCenter /= float(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 p(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]);
+		bounds.sphereRadius = glm::max(bounds.sphereRadius, glm::length(p - bounds.sphereCenter));
+	}
+	return bounds;
+}
+
+MeshView viewOf(const MeshData &mesh)
+{
+	MeshView view;
+	view.vertices = mesh.vertices.data();
+	view.vertexCount = mesh.vertices.size();
+	view.indices = mesh.indices.data();
+	view.indexCount = mesh.indices.size();
+	view.bounds = mesh.bounds;
+	return view;
+}
+
+namespace
+{
+	// Scoring constants from Forsyth, "Linear-Speed Vertex Cache Optimisation"
+	const int SCORE_CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	struct CacheVertex
+	{
+		int cachePosition = -1;
+		int remaining = 0;   // triangles not yet emitted that use this vertex
+		int firstTriangle = 0; // into the adjacency list
+		float score = 0.0f;
+	};
+
+	float vertexScore(const CacheVertex &vertex)
+	{
+		if (vertex.remaining == 0)
+		{
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (vertex.cachePosition >= 0)
+		{
+			if (vertex.cachePosition < 3)
+			{
+				// the triangle just emitted; scored low so strips do not simply continue
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else if (vertex.cachePosition < SCORE_CACHE_SIZE)
+			{
+				float scale = 1.0f / (SCORE_CACHE_SIZE - 3);
+				score = powf(1.0f - (vertex.cachePosition - 3) * scale, CACHE_DECAY_POWER);
+			}
+		}
+		// favour vertices with few triangles left so they can leave the cache for good
+		return score + VALENCE_BOOST_SCALE * powf((float)vertex.remaining, -VALENCE_BOOST_POWER);
+	}
+
+	// first-use order, so the fetches of consecutive triangles stay close in memory
+	void optimizeVertexFetch(MeshData &mesh)
+	{
+		vector<unsigned int> remap(mesh.vertices.size(), ~0u);
+		vector<MeshVertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+		for (unsigned int &index : mesh.indices)
+		{
+			if (remap[index] == ~0u)
+			{
+				remap[index] = (unsigned int)vertices.size();
+				vertices.push_back(mesh.vertices[index]);
+			}
+			index = remap[index];
+		}
+		mesh.vertices.swap(vertices);
+	}
+
+	uint16_t toHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+		int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+		if (exponent <= 0)
+		{
+			return sign; // too small for a normal half; flushed to zero
+		}
+		if (exponent >= 31)
+		{
+			return (uint16_t)(sign | 0x7c00); // infinity
+		}
+		// round to nearest; a carry out of the mantissa correctly bumps the exponent
+		return (uint16_t)(sign | ((exponent << 10) + ((mantissa + 0x1000) >> 13)));
+	}
+
+	uint32_t toSnorm10(float value)
+	{
+		int scaled = (int)lroundf(std::max(-1.0f, std::min(1.0f, value)) * 511.0f);
+		return (uint32_t)scaled & 0x3ff;
+	}
+
+	void append(vector<unsigned char> &out, const void *data, size_t size)
+	{
+		const unsigned char *bytes = (const unsigned char *)data;
+		out.insert(out.end(), bytes, bytes + size);
+	}
+}
+
+void optimizeMesh(MeshData &mesh)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t vertexCount = mesh.vertices.size();
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// triangles using each vertex, as one flat list
+	vector<CacheVertex> vertices(vertexCount);
+	for (unsigned int index : mesh.indices)
+	{
+		vertices[index].remaining++;
+	}
+	int offset = 0;
+	for (CacheVertex &vertex : vertices)
+	{
+		vertex.firstTriangle = offset;
+		offset += vertex.remaining;
+		vertex.score = vertexScore(vertex);
+	}
+	vector<unsigned int> adjacency(mesh.indices.size());
+	vector<int> filled(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = mesh.indices[3 * t + k];
+			adjacency[vertices[v].firstTriangle + filled[v]++] = (unsigned int)t;
+		}
+	}
+
+	vector<float> triangleScore(triangleCount);
+	vector<char> emitted(triangleCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertices[mesh.indices[3 * t]].score + vertices[mesh.indices[3 * t + 1]].score +
+			vertices[mesh.indices[3 * t + 2]].score;
+	}
+
+	// LRU cache, with room for the three vertices pushed in front of it
+	vector<unsigned int> cache, nextCache;
+	cache.reserve(SCORE_CACHE_SIZE + 3);
+	nextCache.reserve(SCORE_CACHE_SIZE + 3);
+
+	vector<unsigned int> result;
+	result.reserve(mesh.indices.size());
+	size_t scanCursor = 0;
+	long best = -1;
+	while (result.size() < mesh.indices.size())
+	{
+		if (best < 0)
+		{
+			// nothing in the cache is connected to anything left; take the next triangle in order
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			best = (long)scanCursor;
+		}
+
+		emitted[best] = 1;
+		const unsigned int *tri = &mesh.indices[3 * best];
+		nextCache.assign(tri, tri + 3);
+		for (int k = 0; k < 3; k++)
+		{
+			result.push_back(tri[k]);
+			// drop the emitted triangle from its vertices' remaining lists
+			CacheVertex &vertex = vertices[tri[k]];
+			unsigned int *list = &adjacency[vertex.firstTriangle];
+			unsigned int *last = list + vertex.remaining - 1;
+			*std::find(list, last, (unsigned int)best) = *last;
+			vertex.remaining--;
+		}
+		for (unsigned int v : cache)
+		{
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+			{
+				nextCache.push_back(v);
+			}
+		}
+		for (size_t i = SCORE_CACHE_SIZE; i < nextCache.size(); i++)
+		{
+			// pushed out of the cache
+			CacheVertex &vertex = vertices[nextCache[i]];
+			float oldScore = vertex.score;
+			vertex.cachePosition = -1;
+			vertex.score = vertexScore(vertex);
+			for (int j = 0; j < vertex.remaining; j++)
+			{
+				triangleScore[adjacency[vertex.firstTriangle + j]] += vertex.score - oldScore;
+			}
+		}
+		if (nextCache.size() > (size_t)SCORE_CACHE_SIZE)
+		{
+			nextCache.resize(SCORE_CACHE_SIZE);
+		}
+		cache.swap(nextCache);
+
+		// rescore the cached vertices and their triangles, picking the best as we go
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			vertices[cache[i]].cachePosition = (int)i;
+		}
+		for (unsigned int v : cache)
+		{
+			CacheVertex &vertex = vertices[v];
+			float oldScore = vertex.score;
+			vertex.score = vertexScore(vertex);
+			for (int j = 0; j < vertex.remaining; j++)
+			{
+				triangleScore[adjacency[vertex.firstTriangle + j]] += vertex.score - oldScore;
+			}
+		}
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache)
+		{
+			const CacheVertex &vertex = vertices[v];
+			for (int j = 0; j < vertex.remaining; j++)
+			{
+				unsigned int t = adjacency[vertex.firstTriangle + j];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = (long)t;
+				}
+			}
+		}
+	}
+
+	mesh.indices.swap(result);
+	optimizeVertexFetch(mesh);
+}
+
+float cacheMissRatio(const unsigned int *indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+	if (indexCount < 3)
+	{
+		return 0.0f;
+	}
+	// FIFO, as on most hardware: a hit does not refresh an entry
+	vector<size_t> insertedAt(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		size_t &stamp = insertedAt[indices[i]];
+		if (stamp == 0 || misses - stamp >= (size_t)cacheSize)
+		{
+			misses++;
+			stamp = misses;
+		}
+	}
+	return (float)misses / (float)(indexCount / 3);
+}
+
+void quantizeVertices(const MeshVertex *vertices, size_t count, vector<PackedVertex> &out)
+{
+	out.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const MeshVertex &in = vertices[i];
+		PackedVertex &packed = out[i];
+		for (int j = 0; j < 3; j++)
+		{
+			packed.position[j] = toHalf(in.position[j]);
+		}
+		packed.position[3] = toHalf(1.0f);
+		packed.normal = toSnorm10(in.normal[0]) | (toSnorm10(in.normal[1]) << 10) | (toSnorm10(in.normal[2]) << 20);
+		packed.texCoord[0] = toHalf(in.texCoord[0]);
+		packed.texCoord[1] = toHalf(in.texCoord[1]);
+	}
+}
+
+void packMeshes(const vector<MeshData> &meshes, vector<unsigned char> &out)
+{
+	unsigned int count = (unsigned int)meshes.size();
+	append(out, &count, sizeof(count));
+	for (const MeshData &mesh : meshes)
+	{
+		PackedMeshHeader header;
+		header.vertexCount = (unsigned int)mesh.vertices.size();
+		header.indexCount = (unsigned int)mesh.indices.size();
+		header.bounds = mesh.bounds;
+		append(out, &header, sizeof(header));
+		append(out, mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex));
+		append(out, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+	}
+}
+
+bool unpackMeshes(const unsigned char *data, size_t size, vector<MeshView> &out)
+{
+	const unsigned char *end = data + size;
+	unsigned int count;
+	if (size < sizeof(count))
+	{
+		return false;
+	}
+	memcpy(&count, data, sizeof(count));
+	data += sizeof(count);
+
+	out.clear();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if ((size_t)(end - data) < sizeof(PackedMeshHeader))
+		{
+			return false;
+		}
+		const PackedMeshHeader *header = (const PackedMeshHeader *)data;
+		data += sizeof(PackedMeshHeader);
+		size_t vertexBytes = header->vertexCount * sizeof(MeshVertex);
+		size_t indexBytes = header->indexCount * sizeof(unsigned int);
+		if ((size_t)(end - data) < vertexBytes + indexBytes)
+		{
+			return false;
+		}
+
+		MeshView view;
+		view.vertices = (const MeshVertex *)data;
+		view.vertexCount = header->vertexCount;
+		view.indices = (const unsigned int *)(data + vertexBytes);
+		view.indexCount = header->indexCount;
+		view.bounds = header->bounds;
+		out.push_back(view);
+		data += vertexBytes + indexBytes;
+	}
+	return true;
+}
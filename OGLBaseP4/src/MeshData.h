@@ -0,0 +1,81 @@
+#pragma once
+#ifndef LAB471_MESHDATA_H_INCLUDED
+#define LAB471_MESHDATA_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <tiny_obj_loader/tiny_obj_loader.h>
+
+// One vertex as uploaded: vertPos (0), vertNor (1) and vertTex (2) interleaved
+struct MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float texCoord[2];
+};
+
+struct MeshBounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	glm::vec3 sphereCenter; // vertex centroid
+	float sphereRadius;
+};
+
+// Mesh ready for upload, owning its arrays; built from an OBJ shape by Shape and the asset packer
+struct MeshData
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<unsigned int> indices;
+	MeshBounds bounds;
+};
+
+// Non-owning view of the same, pointing into a MeshData or a mapped asset archive
+struct MeshView
+{
+	const MeshVertex *vertices = nullptr;
+	size_t vertexCount = 0;
+	const unsigned int *indices = nullptr;
+	size_t indexCount = 0;
+	MeshBounds bounds;
+};
+
+// Quantized form of MeshVertex, half the size: half-float position (w unused),
+// signed normalized 10:10:10:2 normal and half-float texture coordinates
+struct PackedVertex
+{
+	uint16_t position[4];
+	uint32_t normal;
+	uint16_t texCoord[2];
+};
+
+// Interleave an OBJ shape, generating smooth normals when the file has none.
+// Unless optimize is false the result is also run through optimizeMesh.
+void buildMeshData(const tinyobj::shape_t &shape, MeshData &out, bool optimize = true);
+MeshBounds measureMesh(const MeshVertex *vertices, size_t count);
+MeshView viewOf(const MeshData &mesh);
+
+// Reorder triangles for the post-transform vertex cache (Forsyth's linear-speed
+// algorithm), then renumber vertices in first-use order so fetches walk the buffer forwards
+void optimizeMesh(MeshData &mesh);
+// Average vertex shader invocations per triangle for a FIFO cache of cacheSize entries
+// (0.5 is ideal for a regular grid, 3 means no reuse at all)
+float cacheMissRatio(const unsigned int *indices, size_t indexCount, size_t vertexCount, int cacheSize = 32);
+void quantizeVertices(const MeshVertex *vertices, size_t count, std::vector<PackedVertex> &out);
+
+// Archive layout of a mesh: the header, then the vertices, then the indices, all 4-byte aligned
+struct PackedMeshHeader
+{
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	MeshBounds bounds;
+};
+
+// Append every mesh to out as a count followed by packed meshes
+void packMeshes(const std::vector<MeshData> &meshes, std::vector<unsigned char> &out);
+// Views into data, which must stay alive (and mapped) while they are used
+bool unpackMeshes(const unsigned char *data, size_t size, std::vector<MeshView> &out);
+
+#endif // LAB471_MESHDATA_H_INCLUDED
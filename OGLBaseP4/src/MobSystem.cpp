@@ -0,0 +1,202 @@
+#include "MobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include "ChunkData.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include "World.h"
+
+namespace {
+    const float TWO_PI = 6.28318531f;
+    const size_t MIN_SLICE = 512; // mobs per job; smaller slices cost more in hand-off than they save
+    const float HALF_WIDTH = 0.3f;
+    const float HEIGHT = 1.6f;
+    const float WAYPOINT_RADIUS = 0.35f;
+    const float WAYPOINT_TIMEOUT = 2.0f; // seconds to reach the next waypoint before giving up
+
+    // xorshift32, one state per mob so slices never share a generator
+    float random01(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    bool loaded(World& world, int x, int z) {
+        return world.getChunk(world.worldToChunk(x, z)) != nullptr;
+    }
+}
+
+MobSystem::~MobSystem() {
+    GLState::deleteBuffers(1, &instanceVBO);
+}
+
+void MobSystem::init(Shape& s) {
+    shape = &s;
+    capacity = 256;
+    glGenBuffers(1, &instanceVBO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    shape->setInstanceAttribute(INSTANCE_ATTRIBUTE, instanceVBO, 4, sizeof(glm::vec4), 0);
+}
+
+bool MobSystem::spawn(World& world, float x, float z, uint32_t seed) {
+    int bx = (int)std::floor(x), bz = (int)std::floor(z);
+    if (!loaded(world, bx, bz)) return false;
+    int y = CHUNK_HEIGHT - 1;
+    while (y > 0 && world.getBlock(bx, y, bz) == 0) y--;
+
+    uint32_t state = seed ? seed : 1;
+    position.push_back(glm::vec3(x, y + 1.0f, z));
+    verticalSpeed.push_back(0.0f);
+    heading.push_back(random01(state) * TWO_PI);
+    wanderTimer.push_back(random01(state) * 3.0f);
+    walkPhase.push_back(random01(state) * TWO_PI);
+    rng.push_back(state);
+    route.push_back(std::vector<glm::vec3>());
+    routeStep.push_back(0);
+    pose.push_back(glm::vec4(position.back(), heading.back()));
+    return true;
+}
+
+void MobSystem::clear() {
+    position.clear();
+    verticalSpeed.clear();
+    heading.clear();
+    wanderTimer.clear();
+    walkPhase.clear();
+    rng.clear();
+    route.clear();
+    routeStep.clear();
+    pose.clear();
+}
+
+void MobSystem::setRoute(size_t mob, std::vector<glm::vec3> waypoints) {
+    route[mob] = std::move(waypoints);
+    routeStep[mob] = 0;
+    wanderTimer[mob] = WAYPOINT_TIMEOUT;
+}
+
+int MobSystem::followingCount() const {
+    int count = 0;
+    for (size_t i = 0; i < route.size(); i++) {
+        if (routeStep[i] < route[i].size()) count++;
+    }
+    return count;
+}
+
+// Head for the next waypoint, or pick a new heading every few seconds
+void MobSystem::wander(size_t begin, size_t end, float dt) {
+    for (size_t i = begin; i < end; i++) {
+        wanderTimer[i] -= dt;
+        if (routeStep[i] < route[i].size()) {
+            glm::vec3 toward = route[i][routeStep[i]] - position[i];
+            if (std::abs(toward.x) < WAYPOINT_RADIUS && std::abs(toward.z) < WAYPOINT_RADIUS) {
+                routeStep[i]++;
+                wanderTimer[i] = WAYPOINT_TIMEOUT;
+            } else if (wanderTimer[i] <= 0.0f) {
+                route[i].clear();
+            } else {
+                heading[i] = std::atan2(toward.x, toward.z);
+            }
+            continue;
+        }
+        if (wanderTimer[i] <= 0.0f) {
+            heading[i] += (random01(rng[i]) - 0.5f) * 2.0f;
+            wanderTimer[i] = 1.0f + random01(rng[i]) * 3.0f;
+        }
+    }
+}
+
+// Walk along the heading as a swept box, stepping up single blocks and turning back at walls
+// and at the edge of the loaded world, while falling onto whatever is below
+void MobSystem::move(size_t begin, size_t end, float dt, const VoxelCollider& collider, World& world) {
+    float step = walkSpeed * dt;
+    for (size_t i = begin; i < end; i++) {
+        glm::vec3& p = position[i];
+        glm::vec3 walk(std::sin(heading[i]) * step, 0.0f, std::cos(heading[i]) * step);
+        if (!loaded(world, (int)std::floor(p.x + walk.x), (int)std::floor(p.z + walk.z))) {
+            heading[i] += TWO_PI * 0.5f;
+            walk = glm::vec3(0.0f);
+        }
+
+        bool grounded = verticalSpeed[i] == 0.0f;
+        verticalSpeed[i] -= gravity * dt;
+        AABB box = {p + glm::vec3(-HALF_WIDTH, 0.0f, -HALF_WIDTH), p + glm::vec3(HALF_WIDTH, HEIGHT, HALF_WIDTH)};
+        uint8_t hits;
+        glm::vec3 moved = collider.sweep(box, walk + glm::vec3(0.0f, verticalSpeed[i] * dt, 0.0f), &hits);
+        if (hits & VoxelCollider::HIT_Y) verticalSpeed[i] = 0.0f;
+
+        if (hits & (VoxelCollider::HIT_X | VoxelCollider::HIT_Z)) {
+            AABB raised = box;
+            raised.min.y += 1.0f;
+            raised.max.y += 1.0f;
+            uint8_t raisedHits = 0;
+            glm::vec3 climb;
+            if (grounded && !collider.overlaps(raised) &&
+                (climb = collider.sweep(raised, walk, &raisedHits), raisedHits == 0)) {
+                moved = climb + glm::vec3(0.0f, 1.0f, 0.0f);
+                verticalSpeed[i] = 0.0f;
+            } else {
+                heading[i] += TWO_PI * 0.5f;
+            }
+        }
+        p += moved;
+    }
+}
+
+// A small hop in time with the walk, written out as the pose that gets drawn
+void MobSystem::animate(size_t begin, size_t end, float dt) {
+    for (size_t i = begin; i < end; i++) {
+        walkPhase[i] = std::fmod(walkPhase[i] + dt * walkSpeed * 6.0f, TWO_PI);
+        heading[i] = std::fmod(heading[i], TWO_PI);
+        float hop = 0.08f * std::abs(std::sin(walkPhase[i]));
+        pose[i] = glm::vec4(position[i].x, position[i].y + hop, position[i].z, heading[i]);
+    }
+}
+
+void MobSystem::update(float dt, World& world, ThreadPool* pool) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t count = position.size();
+    VoxelCollider collider(world);
+    auto run = [this, dt, &world, &collider](size_t begin, size_t end) {
+        wander(begin, end, dt);
+        move(begin, end, dt, collider, world);
+        animate(begin, end, dt);
+    };
+
+    // the calling thread takes the first slice instead of waiting idle
+    size_t jobs = pool ? std::min<size_t>(pool->size() + 1, std::max<size_t>(1, count / MIN_SLICE)) : 1;
+    size_t slice = (count + jobs - 1) / std::max<size_t>(1, jobs);
+    std::vector<std::future<void>> pending;
+    for (size_t j = 1; j < jobs; j++) {
+        size_t begin = std::min(count, j * slice), end = std::min(count, begin + slice);
+        pending.push_back(pool->submit([run, begin, end]() { run(begin, end); }));
+    }
+    run(0, std::min(count, slice));
+    for (std::future<void>& job : pending) job.get();
+
+    slices = (int)jobs;
+    updateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void MobSystem::submit(RenderQueue& queue, int material, const glm::mat4& model) {
+    if (pose.empty()) return;
+
+    center = glm::vec3(0.0f);
+    for (const glm::vec4& p : pose) center += glm::vec3(p);
+    center /= (float)pose.size();
+
+    // the whole buffer changes every frame; orphan it rather than wait on last frame's draw
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    capacity = std::max(capacity, pose.size());
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, pose.size() * sizeof(glm::vec4), pose.data());
+
+    queue.submitInstanced(RenderQueue::PASS_OPAQUE, material, shape->getVAO(), shape->getIndexCount(),
+                          (GLsizei)pose.size(), queue.addModel(model), center);
+}
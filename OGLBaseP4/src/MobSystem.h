@@ -0,0 +1,68 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "VoxelCollision.h"
+
+class RenderQueue;
+class Shape;
+class ThreadPool;
+
+// Wandering mobs kept as a structure of arrays: one array per component, and each system is a
+// loop over just the arrays it touches. Entities never reference each other, so update() cuts
+// the index range into slices and runs every system over each slice on the worker threads.
+// Rendering is one instanced draw of the mob mesh fed from a per-instance pose buffer.
+// A mob given a route walks it waypoint by waypoint instead of wandering.
+class MobSystem {
+public:
+    enum { INSTANCE_ATTRIBUTE = 3 }; // instancePose in lit_vert.glsl
+
+    float walkSpeed = 1.5f;  // blocks per second
+    float gravity = 20.0f;
+
+    ~MobSystem();
+    // Mobs are drawn with shape's mesh; its VAO gains the per-instance pose attribute
+    void init(Shape& shape);
+    // Stand a mob on the highest solid block of its column; false if that column is not loaded
+    bool spawn(World& world, float x, float z, uint32_t seed);
+    void clear();
+    size_t size() const { return position.size(); }
+    const glm::vec3& getPosition(size_t mob) const { return position[mob]; }
+    // Follow waypoints (feet positions, e.g. from Navigation) until the last is reached or
+    // one takes too long to reach; an empty route goes back to wandering
+    void setRoute(size_t mob, std::vector<glm::vec3> waypoints);
+    int followingCount() const;
+
+    // Wander, move with ground collision and animate every mob. Without a pool everything
+    // runs on the calling thread. World must not change while this runs.
+    void update(float dt, World& world, ThreadPool* pool);
+    // Queue one instanced draw of every mob; model is the transform they all share
+    void submit(RenderQueue& queue, int material, const glm::mat4& model);
+
+    double lastUpdateMs() const { return updateMs; }
+    int lastSlices() const { return slices; }
+
+private:
+    // components
+    std::vector<glm::vec3> position;  // feet, in blocks
+    std::vector<float> verticalSpeed;
+    std::vector<float> heading;       // radians about +y
+    std::vector<float> wanderTimer;   // seconds until the next change of heading
+    std::vector<float> walkPhase;
+    std::vector<uint32_t> rng;
+    std::vector<std::vector<glm::vec3>> route;
+    std::vector<uint32_t> routeStep;  // next waypoint; past the end when wandering
+    std::vector<glm::vec4> pose;      // system output: xyz drawn position, w yaw
+
+    Shape* shape = nullptr;
+    GLuint instanceVBO = 0;
+    size_t capacity = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    double updateMs = 0.0;
+    int slices = 0;
+
+    void wander(size_t begin, size_t end, float dt);
+    void move(size_t begin, size_t end, float dt, const VoxelCollider& collider, World& world);
+    void animate(size_t begin, size_t end, float dt);
+};
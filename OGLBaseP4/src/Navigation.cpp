@@ -0,0 +1,373 @@
+#include "Navigation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include "ThreadPool.h"
+#include "World.h"
+
+namespace {
+    const int NEIGHBOURS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    // portal index of the two search nodes that are not portals
+    const int START_NODE = -1;
+    const int GOAL_NODE = -2;
+
+    int floorDiv(int v, int d) { return (int)std::floor((float)v / d); }
+
+    uint64_t nodeKey(const ChunkCoord& coord, int portal) {
+        return ((uint64_t)(uint16_t)coord.x << 48) | ((uint64_t)(uint16_t)coord.z << 32) | (uint32_t)(portal + 2);
+    }
+}
+
+void Navigation::addChunk(const ChunkCoord& coord) {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    ChunkNav& nav = chunks[coord];
+    nav.coord = coord;
+    buildCells(nav);
+    dirty.erase(coord); // edits made while the chunk was generated are already in its cells
+    for (const auto& offset : NEIGHBOURS) {
+        auto neighbour = chunks.find(ChunkCoord{coord.x + offset[0], coord.z + offset[1]});
+        if (neighbour == chunks.end()) continue;
+        connect(nav, neighbour->second);
+        linkPortals(neighbour->second);
+    }
+    linkPortals(nav);
+}
+
+void Navigation::blockChanged(int x, int y, int z) {
+    dirty.insert(ChunkCoord{floorDiv(x, CHUNK_SIZE), floorDiv(z, CHUNK_SIZE)});
+}
+
+// A changed block only alters cells in its own column, but the chunk's portals on every border
+// may move with them, so the neighbours' links are redone as well
+int Navigation::update() {
+    if (dirty.empty()) return 0;
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    int rebuilt = 0;
+    for (const ChunkCoord& coord : dirty) {
+        auto found = chunks.find(coord);
+        if (found == chunks.end()) continue;
+        ChunkNav& nav = found->second;
+        buildCells(nav);
+        nav.portals.clear();
+        for (const auto& offset : NEIGHBOURS) {
+            auto neighbour = chunks.find(ChunkCoord{coord.x + offset[0], coord.z + offset[1]});
+            if (neighbour == chunks.end()) continue;
+            connect(nav, neighbour->second);
+            linkPortals(neighbour->second);
+        }
+        linkPortals(nav);
+        rebuilt++;
+    }
+    dirty.clear();
+    return rebuilt;
+}
+
+// Scan each column top down, counting the run of air above every block
+void Navigation::buildCells(ChunkNav& nav) {
+    nav.cells.clear();
+    const ChunkData* data = world.getChunk(nav.coord);
+    int originX = nav.coord.x * CHUNK_SIZE, originZ = nav.coord.z * CHUNK_SIZE;
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            nav.columnStart[x * CHUNK_SIZE + z] = (int)nav.cells.size();
+            if (!data) continue;
+            const VoxelStorage<DefaultChunkDims>& voxels = data->getVoxels();
+            int air = 1; // above the top of the world is open
+            for (int y = CHUNK_HEIGHT - 1; y > 0; y--) {
+                if (voxels.get(x, y, z) != 0) {
+                    air = 0;
+                    continue;
+                }
+                air++;
+                if (air >= 2 && voxels.get(x, y - 1, z) != 0) {
+                    nav.cells.push_back(Cell{originX + x, y, originZ + z, std::min(air, 3)});
+                }
+            }
+        }
+    }
+    nav.columnStart[CHUNK_SIZE * CHUNK_SIZE] = (int)nav.cells.size();
+}
+
+// Replace the portals between two adjacent chunks. Transitions along the shared border are
+// grouped into entrances: runs over consecutive border columns whose heights differ by at most
+// one block. Each entrance contributes its middle transition as a portal on both sides.
+void Navigation::connect(ChunkNav& a, ChunkNav& b) {
+    // entrances follow the heights on a's side, so always join a pair the same way round, or a
+    // chunk rebuilt after an edit would get different portals than a fresh build gives it
+    if (b.coord.x < a.coord.x || (b.coord.x == a.coord.x && b.coord.z < a.coord.z)) {
+        connect(b, a);
+        return;
+    }
+    auto dropTo = [](ChunkNav& nav, const ChunkCoord& other) {
+        nav.portals.erase(std::remove_if(nav.portals.begin(), nav.portals.end(),
+            [&other](const Portal& portal) { return portal.neighbour == other; }), nav.portals.end());
+    };
+    dropTo(a, b.coord);
+    dropTo(b, a.coord);
+
+    int dx = b.coord.x - a.coord.x, dz = b.coord.z - a.coord.z;
+    int last = CHUNK_SIZE - 1;
+    struct Transition { int cellA, cellB; };
+    struct Entrance { std::vector<Transition> members; int lastT, lastY; };
+    std::vector<Entrance> entrances;
+
+    for (int t = 0; t < CHUNK_SIZE; t++) {
+        int columnA, columnB;
+        if (dx != 0) {
+            columnA = (dx > 0 ? last : 0) * CHUNK_SIZE + t;
+            columnB = (dx > 0 ? 0 : last) * CHUNK_SIZE + t;
+        } else {
+            columnA = t * CHUNK_SIZE + (dz > 0 ? last : 0);
+            columnB = t * CHUNK_SIZE + (dz > 0 ? 0 : last);
+        }
+        for (int i = a.columnStart[columnA]; i < a.columnStart[columnA + 1]; i++) {
+            for (int j = b.columnStart[columnB]; j < b.columnStart[columnB + 1]; j++) {
+                if (!canStep(a.cells[i], b.cells[j])) continue;
+                // extend an entrance that reached the previous column at a nearby height
+                int y = a.cells[i].y;
+                Entrance* extended = nullptr;
+                for (Entrance& entrance : entrances) {
+                    if (entrance.lastT == t - 1 && std::abs(entrance.lastY - y) <= 1) {
+                        extended = &entrance;
+                        break;
+                    }
+                }
+                if (!extended) {
+                    entrances.push_back(Entrance());
+                    extended = &entrances.back();
+                }
+                extended->members.push_back(Transition{i, j});
+                extended->lastT = t;
+                extended->lastY = y;
+            }
+        }
+    }
+
+    for (const Entrance& entrance : entrances) {
+        const Transition& middle = entrance.members[entrance.members.size() / 2];
+        const Cell& cellA = a.cells[middle.cellA];
+        const Cell& cellB = b.cells[middle.cellB];
+        a.portals.push_back(Portal{middle.cellA, b.coord, glm::ivec3(cellB.x, cellB.y, cellB.z), {}});
+        b.portals.push_back(Portal{middle.cellB, a.coord, glm::ivec3(cellA.x, cellA.y, cellA.z), {}});
+    }
+}
+
+// Walking distance between every pair of portals of a chunk, one breadth-first walk each
+void Navigation::linkPortals(ChunkNav& nav) {
+    std::vector<int> distance;
+    for (size_t i = 0; i < nav.portals.size(); i++) {
+        Portal& portal = nav.portals[i];
+        portal.links.clear();
+        walkDistances(nav, portal.cell, distance);
+        for (size_t j = 0; j < nav.portals.size(); j++) {
+            int d = distance[nav.portals[j].cell];
+            if (j != i && d >= 0) portal.links.push_back(std::make_pair((int)j, d));
+        }
+    }
+}
+
+// Level moves need the body's two blocks; a step up or down also needs a third above the
+// lower cell for the head to pass. Symmetric, so every walk can be reversed.
+bool Navigation::canStep(const Cell& from, const Cell& to) {
+    int dy = to.y - from.y;
+    if (dy > 1 || dy < -1) return false;
+    if (dy > 0) return from.clearance >= 3;
+    if (dy < 0) return to.clearance >= 3;
+    return true;
+}
+
+void Navigation::walkDistances(const ChunkNav& nav, int from, std::vector<int>& distance, std::vector<int>* parent) {
+    distance.assign(nav.cells.size(), -1);
+    if (parent) parent->assign(nav.cells.size(), -1);
+    std::vector<int> frontier;
+    frontier.reserve(nav.cells.size());
+    frontier.push_back(from);
+    distance[from] = 0;
+    int originX = nav.coord.x * CHUNK_SIZE, originZ = nav.coord.z * CHUNK_SIZE;
+    for (size_t next = 0; next < frontier.size(); next++) {
+        int current = frontier[next];
+        const Cell& cell = nav.cells[current];
+        for (const auto& offset : NEIGHBOURS) {
+            int x = cell.x - originX + offset[0], z = cell.z - originZ + offset[1];
+            if (x < 0 || x >= CHUNK_SIZE || z < 0 || z >= CHUNK_SIZE) continue;
+            int column = x * CHUNK_SIZE + z;
+            for (int i = nav.columnStart[column]; i < nav.columnStart[column + 1]; i++) {
+                if (distance[i] >= 0 || !canStep(cell, nav.cells[i])) continue;
+                distance[i] = distance[current] + 1;
+                if (parent) (*parent)[i] = current;
+                frontier.push_back(i);
+            }
+        }
+    }
+}
+
+// Append the cells after from, up to and including to
+bool Navigation::walkPath(const ChunkNav& nav, int from, int to, Path& out) {
+    std::vector<int> distance, parent;
+    walkDistances(nav, from, distance, &parent);
+    if (distance[to] < 0) return false;
+    size_t first = out.size();
+    for (int i = to; i != from; i = parent[i]) {
+        const Cell& cell = nav.cells[i];
+        out.push_back(glm::vec3(cell.x + 0.5f, (float)cell.y, cell.z + 0.5f));
+    }
+    std::reverse(out.begin() + first, out.end());
+    return true;
+}
+
+// The walkable cell of the column under position nearest its height
+bool Navigation::locate(const glm::vec3& position, Location& out) const {
+    int x = (int)std::floor(position.x), z = (int)std::floor(position.z);
+    int y = (int)std::floor(position.y + 0.5f);
+    auto found = chunks.find(ChunkCoord{floorDiv(x, CHUNK_SIZE), floorDiv(z, CHUNK_SIZE)});
+    if (found == chunks.end()) return false;
+    const ChunkNav& nav = found->second;
+    int column = (x - nav.coord.x * CHUNK_SIZE) * CHUNK_SIZE + (z - nav.coord.z * CHUNK_SIZE);
+    int best = -1;
+    for (int i = nav.columnStart[column]; i < nav.columnStart[column + 1]; i++) {
+        if (best < 0 || std::abs(nav.cells[i].y - y) < std::abs(nav.cells[best].y - y)) best = i;
+    }
+    if (best < 0 || std::abs(nav.cells[best].y - y) > 2) return false;
+    out.chunk = &nav;
+    out.cell = best;
+    return true;
+}
+
+// A* over the portal graph, with the start and goal cells joined to the portals of their own
+// chunks, then each leg refined into blocks inside the chunk it crosses
+Navigation::Path Navigation::findPath(const glm::vec3& start, const glm::vec3& goal) const {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    Path path;
+    Location from, to;
+    if (!locate(start, from) || !locate(goal, to)) return path;
+
+    const Cell& first = from.chunk->cells[from.cell];
+    path.push_back(glm::vec3(first.x + 0.5f, (float)first.y, first.z + 0.5f));
+    if (from.chunk == to.chunk && walkPath(*from.chunk, from.cell, to.cell, path)) return path;
+
+    std::vector<int> startDistance, goalDistance;
+    walkDistances(*from.chunk, from.cell, startDistance);
+    walkDistances(*to.chunk, to.cell, goalDistance);
+    const Cell& target = to.chunk->cells[to.cell];
+    // A step moves one column and at most one block up or down, so it closes at most one block
+    // of the horizontal distance and one of the height; the larger of the two never overestimates
+    auto estimate = [&target](const Cell& c) {
+        return std::max(std::abs(c.x - target.x) + std::abs(c.z - target.z), std::abs(c.y - target.y));
+    };
+
+    struct Node {
+        const ChunkNav* chunk;
+        int portal;
+        int cost;
+        int parent;
+    };
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, int> index;
+    typedef std::pair<int, int> Open; // (estimate, node)
+    std::priority_queue<Open, std::vector<Open>, std::greater<Open>> open;
+
+    auto cellOf = [](const Node& node) -> int {
+        return node.portal >= 0 ? node.chunk->portals[node.portal].cell : -1;
+    };
+    auto reach = [&](const ChunkNav* chunk, int portal, int cost, int parent) {
+        uint64_t key = nodeKey(chunk->coord, portal);
+        auto known = index.find(key);
+        if (known != index.end() && nodes[known->second].cost <= cost) return;
+        int id;
+        if (known == index.end()) {
+            id = (int)nodes.size();
+            index[key] = id;
+            nodes.push_back(Node{chunk, portal, cost, parent});
+        } else {
+            id = known->second;
+            nodes[id].cost = cost;
+            nodes[id].parent = parent;
+        }
+        int remaining = portal >= 0 ? estimate(chunk->cells[chunk->portals[portal].cell]) : 0;
+        open.push(Open(cost + remaining, id));
+    };
+
+    reach(from.chunk, START_NODE, 0, -1);
+    int reached = -1;
+    while (!open.empty()) {
+        Open top = open.top();
+        open.pop();
+        Node node = nodes[top.second];
+        int id = top.second;
+        if (node.portal == GOAL_NODE) {
+            reached = id;
+            break;
+        }
+        int cell = cellOf(node);
+        int remaining = cell >= 0 ? estimate(node.chunk->cells[cell]) : 0;
+        if (top.first > node.cost + remaining) continue; // stale entry
+
+        if (node.portal == START_NODE) {
+            for (size_t p = 0; p < from.chunk->portals.size(); p++) {
+                int d = startDistance[from.chunk->portals[p].cell];
+                if (d >= 0) reach(from.chunk, (int)p, d, id);
+            }
+            continue;
+        }
+        const Portal& portal = node.chunk->portals[node.portal];
+        for (const std::pair<int, int>& link : portal.links) {
+            reach(node.chunk, link.first, node.cost + link.second, id);
+        }
+        if (node.chunk == to.chunk && goalDistance[cell] >= 0) {
+            reach(to.chunk, GOAL_NODE, node.cost + goalDistance[cell], id);
+        }
+        auto neighbour = chunks.find(portal.neighbour);
+        if (neighbour == chunks.end()) continue;
+        const ChunkNav& other = neighbour->second;
+        for (size_t p = 0; p < other.portals.size(); p++) {
+            const Cell& c = other.cells[other.portals[p].cell];
+            if (other.portals[p].neighbour == node.chunk->coord && glm::ivec3(c.x, c.y, c.z) == portal.across) {
+                reach(&other, (int)p, node.cost + 1, id);
+                break;
+            }
+        }
+    }
+    if (reached < 0) {
+        path.clear();
+        return path;
+    }
+
+    // walk the abstract route back to front, then refine it leg by leg
+    std::vector<Location> route;
+    for (int id = reached; id >= 0; id = nodes[id].parent) {
+        const Node& node = nodes[id];
+        int cell = node.portal == START_NODE ? from.cell : node.portal == GOAL_NODE ? to.cell : cellOf(node);
+        route.push_back(Location{node.chunk, cell});
+    }
+    std::reverse(route.begin(), route.end());
+    for (size_t i = 1; i < route.size(); i++) {
+        const Location& a = route[i - 1];
+        const Location& b = route[i];
+        if (a.chunk == b.chunk) {
+            if (a.cell != b.cell) walkPath(*a.chunk, a.cell, b.cell, path);
+        } else {
+            const Cell& cell = b.chunk->cells[b.cell];
+            path.push_back(glm::vec3(cell.x + 0.5f, (float)cell.y, cell.z + 0.5f));
+        }
+    }
+    return path;
+}
+
+std::future<Navigation::Path> Navigation::requestPath(ThreadPool& pool, const glm::vec3& start, const glm::vec3& goal) const {
+    return pool.submit([this, start, goal]() { return findPath(start, goal); });
+}
+
+size_t Navigation::chunkCount() const {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    return chunks.size();
+}
+
+size_t Navigation::portalCount() const {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto& chunk : chunks) count += chunk.second.portals.size();
+    return count;
+}
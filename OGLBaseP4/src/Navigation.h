@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ChunkData.h"
+#include "ChunkSystem.h"
+
+class ThreadPool;
+class World;
+
+// Hierarchical (HPA*) pathfinding over the walkable surfaces of the world. A cell is walkable
+// when the block below it is solid and it has two blocks of air for a body; walkers step
+// between the four neighbouring columns and up or down one block at a time.
+//
+// Every chunk is one cluster. Where walkable cells line up across a chunk border they are
+// grouped into entrances, and the middle pair of each entrance becomes a portal on either
+// side. Portals of the same chunk are linked by their walking distance inside it, which gives
+// a small abstract graph of portals that a path search crosses chunk by chunk before walking
+// only the few chunks it passes through at block resolution.
+//
+// Searches read only this class's own copy of the walkable cells, never the World, so they
+// run on worker threads while the main thread edits blocks. Edits mark their chunk dirty and
+// update() rebuilds it, with its border portals, under an exclusive lock.
+class Navigation {
+public:
+    typedef std::vector<glm::vec3> Path; // feet positions at block centres, start to goal
+
+    explicit Navigation(World& world) : world(world) {}
+
+    // Find the walkable cells of a newly loaded chunk and join it to the loaded neighbours
+    void addChunk(const ChunkCoord& coord);
+    // Called for every World::setBlock; the chunk is rebuilt by the next update()
+    void blockChanged(int x, int y, int z);
+    // Rebuild chunks whose blocks changed, returning how many were rebuilt
+    int update();
+
+    // Shortest walk from the cell under start to the cell under goal, or empty when there is
+    // none. Safe to call from any thread.
+    Path findPath(const glm::vec3& start, const glm::vec3& goal) const;
+    // findPath on one of pool's workers
+    std::future<Path> requestPath(ThreadPool& pool, const glm::vec3& start, const glm::vec3& goal) const;
+
+    size_t chunkCount() const;
+    size_t portalCount() const;
+
+private:
+    struct Cell {
+        int x, y, z;   // world block the feet are in
+        int clearance; // air blocks from y up, counted to 3
+    };
+    // One side of an entrance: cell is in this chunk and steps onto across in neighbour
+    struct Portal {
+        int cell;
+        ChunkCoord neighbour;
+        glm::ivec3 across;
+        std::vector<std::pair<int, int>> links; // (portal, walking distance) inside this chunk
+    };
+    struct ChunkNav {
+        ChunkCoord coord;
+        std::vector<Cell> cells; // ordered by column
+        int columnStart[CHUNK_SIZE * CHUNK_SIZE + 1];
+        std::vector<Portal> portals;
+    };
+    // A cell and the chunk it belongs to
+    struct Location {
+        const ChunkNav* chunk;
+        int cell;
+    };
+
+    World& world;
+    std::unordered_map<ChunkCoord, ChunkNav> chunks;
+    std::unordered_set<ChunkCoord> dirty;
+    mutable std::shared_timed_mutex mutex;
+
+    void buildCells(ChunkNav& nav);
+    void connect(ChunkNav& a, ChunkNav& b);
+    static void linkPortals(ChunkNav& nav);
+
+    static bool canStep(const Cell& from, const Cell& to);
+    // Breadth-first walk inside one chunk; distance is -1 for cells that cannot be reached
+    static void walkDistances(const ChunkNav& nav, int from, std::vector<int>& distance, std::vector<int>* parent = nullptr);
+    static bool walkPath(const ChunkNav& nav, int from, int to, Path& out);
+    bool locate(const glm::vec3& position, Location& out) const;
+};
@@ -0,0 +1,132 @@
+#include "OcclusionQueries.h"
+#include "GLState.h"
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+OcclusionQueries::~OcclusionQueries() {
+    for (auto& pair : queries) {
+        glDeleteQueries(1, &pair.second.query);
+    }
+    GLState::deleteBuffers(1, &cubeVBO);
+    GLState::deleteBuffers(1, &cubeEBO);
+    GLState::deleteVertexArrays(1, &cubeVAO);
+}
+
+void OcclusionQueries::init() {
+    // unit cube, position only; the box shader reads nothing else
+    const float corners[] = {
+        0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+        0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1
+    };
+    const unsigned int faces[] = {
+        0, 2, 1,  0, 3, 2,  4, 5, 6,  4, 6, 7,
+        0, 1, 5,  0, 5, 4,  3, 6, 2,  3, 7, 6,
+        0, 4, 7,  0, 7, 3,  1, 2, 6,  1, 6, 5
+    };
+
+    glGenVertexArrays(1, &cubeVAO);
+    glGenBuffers(1, &cubeVBO);
+    glGenBuffers(1, &cubeEBO);
+    GLState::bindVertexArray(cubeVAO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glEnableVertexAttribArray(0);
+    GLState::bindVertexArray(0);
+}
+
+const char* OcclusionQueries::modeName(Mode mode) {
+    switch (mode) {
+        case PREVIOUS_RESULT: return "previous result";
+        case CONDITIONAL: return "conditional render";
+        default: return "off";
+    }
+}
+
+void OcclusionQueries::collectResults() {
+    frame++;
+    hidden = 0;
+    issued = 0;
+    candidates.clear();
+
+    for (auto& pair : queries) {
+        ChunkQuery& q = pair.second;
+        if (!q.pending) continue;
+        GLuint available = 0;
+        glGetQueryObjectuiv(q.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint samples = 0;
+        glGetQueryObjectuiv(q.query, GL_QUERY_RESULT, &samples);
+        q.visible = samples != 0;
+        q.pending = false;
+    }
+}
+
+bool OcclusionQueries::testChunk(const ChunkCoord& coord, const glm::vec3& min, const glm::vec3& max, const glm::vec3& eye, GLuint& condition) {
+    condition = 0;
+    // a box around the camera would be clipped by the near plane and read as hidden
+    const float margin = 1.0f;
+    if (eye.x >= min.x - margin && eye.y >= min.y - margin && eye.z >= min.z - margin &&
+        eye.x <= max.x + margin && eye.y <= max.y + margin && eye.z <= max.z + margin) {
+        return true;
+    }
+
+    ChunkQuery& q = queries[coord];
+    if (!q.pending) {
+        candidates.push_back({coord, min, max, q.lastIssued});
+    }
+    if (!q.visible) hidden++;
+
+    if (mode == CONDITIONAL && q.query != 0) {
+        // NO_WAIT draws the chunk anyway if the GPU has not finished the query
+        condition = q.query;
+        return true;
+    }
+    return q.visible;
+}
+
+void OcclusionQueries::forget(const ChunkCoord& coord) {
+    auto it = queries.find(coord);
+    if (it != queries.end() && !it->second.pending) {
+        it->second.visible = true;
+    }
+}
+
+void OcclusionQueries::issueQueries(GLint modelLoc) {
+    if (candidates.empty()) return;
+
+    // the chunks tested longest ago go first, so every chunk is revisited within a few frames
+    int count = std::min<int>(budget, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.lastIssued < b.lastIssued; });
+
+    GLState::colorMask(false);
+    GLState::depthMask(false);
+    GLState::depthFunc(GL_LEQUAL); // box faces lying on the chunk's own surface still count
+    GLState::setEnabled(GL_CULL_FACE, false);
+    GLState::bindVertexArray(cubeVAO);
+
+    for (int i = 0; i < count; i++) {
+        const Candidate& c = candidates[i];
+        ChunkQuery& q = queries[c.coord];
+        if (q.query == 0) glGenQueries(1, &q.query);
+
+        glm::mat4 M = glm::translate(glm::mat4(1.0f), c.min) * glm::scale(glm::mat4(1.0f), c.max - c.min);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(M));
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, q.query);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        q.pending = true;
+        q.lastIssued = frame;
+        issued++;
+    }
+
+    GLState::setEnabled(GL_CULL_FACE, true);
+    GLState::depthFunc(GL_LESS);
+    GLState::depthMask(true);
+    GLState::colorMask(true);
+}
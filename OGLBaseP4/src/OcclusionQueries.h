@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ChunkSystem.h"
+
+// Hardware occlusion culling for chunks. After the visible chunks are drawn, a budgeted
+// set of chunk bounding boxes is rasterized against the depth buffer inside
+// GL_ANY_SAMPLES_PASSED queries. Results are only read once the GPU reports them
+// available, so the CPU never waits; chunks are skipped either from the last known result
+// or on the GPU with conditional rendering.
+class OcclusionQueries {
+public:
+    enum Mode { OFF, PREVIOUS_RESULT, CONDITIONAL, MODE_COUNT };
+
+    Mode mode = OFF;
+    int budget = 64; // boxes tested per frame
+
+    ~OcclusionQueries();
+    void init();
+    static const char* modeName(Mode mode);
+
+    // Read back whatever results have arrived since last frame
+    void collectResults();
+    // Whether to draw the chunk this frame. In CONDITIONAL mode condition is set to the query
+    // the chunk's draws should be conditionally rendered on, otherwise it is left 0.
+    // Chunks the camera is inside are always drawn and never tested.
+    bool testChunk(const ChunkCoord& coord, const glm::vec3& min, const glm::vec3& max, const glm::vec3& eye, GLuint& condition);
+    // Chunks that left the view are trusted to be visible again when they come back
+    void forget(const ChunkCoord& coord);
+    // Draw the queued boxes with colour and depth writes off; modelLoc is the bound program's M
+    void issueQueries(GLint modelLoc);
+
+    int hiddenCount() const { return hidden; }
+    int issuedCount() const { return issued; }
+
+private:
+    struct ChunkQuery {
+        GLuint query = 0;
+        bool pending = false;
+        bool visible = true;
+        unsigned lastIssued = 0;
+    };
+    struct Candidate {
+        ChunkCoord coord;
+        glm::vec3 min, max;
+        unsigned lastIssued;
+    };
+
+    GLuint cubeVAO = 0, cubeVBO = 0, cubeEBO = 0;
+    std::unordered_map<ChunkCoord, ChunkQuery> queries;
+    std::vector<Candidate> candidates;
+    unsigned frame = 0;
+    int hidden = 0;
+    int issued = 0;
+};
@@ -3,13 +3,24 @@
 #include <iostream>
 #include <cassert>
 #include <fstream>
+#include <algorithm>
 
+#include "AssetArchive.h"
 #include "GLSL.h"
+#include "GLState.h"
+#include "ProgramCache.h"
 
 
 std::string readFileAsString(const std::string &fileName)
 {
 	std::string result;
+
+	AssetArchive::Blob blob;
+	if (AssetArchive::find(fileName, AssetArchive::ASSET_TEXT, blob))
+	{
+		result.assign((const char *)blob.data, blob.size);
+		return result;
+	}
 	std::ifstream fileHandle(fileName);
 
 	if (fileHandle.is_open())
@@ -28,6 +39,44 @@ std::string readFileAsString(const std::string &fileName)
 	return result;
 }
 
+static const char *UNIFORM_SLOT_NAMES[UNIFORM_SLOT_COUNT] = {
+	"M", "MatShine", "Texture0", "alphaTexture", "pColor", "skybox", "farP", "lightDir",
+	"loadedBounds", "heightMap", "colorMap", "tileOrigin", "tileSize", "texels", "mipLevel", "fogRange"
+};
+
+// GLSL requires #version to come first, so the defines go on the line after it
+static std::string injectDefines(const std::string &source, const std::vector<std::string> &defines)
+{
+	if (defines.empty())
+	{
+		return source;
+	}
+
+	std::string block;
+	for (const std::string &name : defines)
+	{
+		block += "#define " + name + "\n";
+	}
+
+	size_t version = source.find("#version");
+	if (version == std::string::npos)
+	{
+		return block + source;
+	}
+	size_t lineEnd = source.find('\n', version);
+	if (lineEnd == std::string::npos)
+	{
+		return source + "\n" + block;
+	}
+	// #line keeps compiler messages pointing at the lines of the file on disk
+	return source.substr(0, lineEnd + 1) + block + "#line 2\n" + source.substr(lineEnd + 1);
+}
+
+const char *Program::getUniformName(UniformSlot slot)
+{
+	return UNIFORM_SLOT_NAMES[slot];
+}
+
 void Program::setShaderNames(const std::string &v, const std::string &f)
 {
 	vShaderName = v;
@@ -38,13 +87,26 @@ bool Program::init()
 {
 	GLint rc;
 
+	std::fill(slots, slots + UNIFORM_SLOT_COUNT, -1);
+
+	// Read shader sources
+	std::string vShaderString = injectDefines(readFileAsString(vShaderName), defines);
+	std::string fShaderString = injectDefines(readFileAsString(fShaderName), defines);
+
+	// A cached binary for exactly these sources and feedback layout skips compiling and linking
+	ProgramCache::FeedbackLayout feedback;
+	feedback.varyings = feedbackVaryings;
+	feedback.mode = feedbackMode;
+	pid = glCreateProgram();
+	if (ProgramCache::load(pid, vShaderString, fShaderString, feedback))
+	{
+		return true;
+	}
+
 	// Create shader handles
 	GLuint VS = glCreateShader(GL_VERTEX_SHADER);
 	GLuint FS = glCreateShader(GL_FRAGMENT_SHADER);
 
-	// Read shader sources
-	std::string vShaderString = readFileAsString(vShaderName);
-	std::string fShaderString = readFileAsString(fShaderName);
 	const char *vshader = vShaderString.c_str();
 	const char *fshader = fShaderString.c_str();
 	CHECKED_GL_CALL(glShaderSource(VS, 1, &vshader, NULL));
@@ -76,10 +138,20 @@ bool Program::init()
 		return false;
 	}
 
-	// Create the program and link
-	pid = glCreateProgram();
+	// Link the program
 	CHECKED_GL_CALL(glAttachShader(pid, VS));
 	CHECKED_GL_CALL(glAttachShader(pid, FS));
+	// the captured varyings are part of the program binary, and of its cache key
+	if (!feedbackVaryings.empty())
+	{
+		std::vector<const char *> names;
+		for (const std::string &name : feedbackVaryings)
+		{
+			names.push_back(name.c_str());
+		}
+		CHECKED_GL_CALL(glTransformFeedbackVaryings(pid, (GLsizei)names.size(), names.data(), feedbackMode));
+	}
+	ProgramCache::prepare(pid);
 	CHECKED_GL_CALL(glLinkProgram(pid));
 	CHECKED_GL_CALL(glGetProgramiv(pid, GL_LINK_STATUS, &rc));
 	if (!rc)
@@ -92,17 +164,18 @@ bool Program::init()
 		return false;
 	}
 
+	ProgramCache::store(pid, vShaderString, fShaderString, feedback);
 	return true;
 }
 
 void Program::bind()
 {
-	CHECKED_GL_CALL(glUseProgram(pid));
+	GLState::useProgram(pid);
 }
 
 void Program::unbind()
 {
-	CHECKED_GL_CALL(glUseProgram(0));
+	GLState::useProgram(0);
 }
 
 void Program::addAttribute(const std::string &name)
@@ -112,7 +185,30 @@ void Program::addAttribute(const std::string &name)
 
 void Program::addUniform(const std::string &name)
 {
-	uniforms[name] = GLSL::getUniformLocation(pid, name.c_str(), isVerbose());
+	GLint location = GLSL::getUniformLocation(pid, name.c_str(), isVerbose());
+	uniforms[name] = location;
+	for (int slot = 0; slot < UNIFORM_SLOT_COUNT; slot++)
+	{
+		if (name == UNIFORM_SLOT_NAMES[slot])
+		{
+			slots[slot] = location;
+		}
+	}
+}
+
+bool Program::bindUniformBlock(const std::string &name, GLuint binding)
+{
+	GLuint index = glGetUniformBlockIndex(pid, name.c_str());
+	if (index == GL_INVALID_INDEX)
+	{
+		if (isVerbose())
+		{
+			std::cout << name << " is not a uniform block" << std::endl;
+		}
+		return false;
+	}
+	CHECKED_GL_CALL(glUniformBlockBinding(pid, index, binding));
+	return true;
 }
 
 GLint Program::getAttribute(const std::string &name) const
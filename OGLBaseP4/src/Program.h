@@ -6,12 +6,36 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 
 
 std::string readFileAsString(const std::string &fileName);
 
+// Uniforms set inside the frame loop. Their locations are cached in a flat array when
+// added, so draws index by slot instead of searching the name map.
+enum UniformSlot
+{
+	UNIFORM_M,
+	UNIFORM_MAT_SHINE,
+	UNIFORM_TEXTURE0,
+	UNIFORM_ALPHA_TEXTURE,
+	UNIFORM_P_COLOR,
+	UNIFORM_SKYBOX,
+	UNIFORM_FAR_P,
+	UNIFORM_LIGHT_DIR,
+	UNIFORM_LOADED_BOUNDS,
+	UNIFORM_HEIGHT_MAP,
+	UNIFORM_COLOR_MAP,
+	UNIFORM_TILE_ORIGIN,
+	UNIFORM_TILE_SIZE,
+	UNIFORM_TEXELS,
+	UNIFORM_MIP_LEVEL,
+	UNIFORM_FOG_RANGE,
+	UNIFORM_SLOT_COUNT
+};
+
 class Program
 {
 
@@ -21,6 +45,14 @@ public:
 	bool isVerbose() const { return verbose; }
 
 	void setShaderNames(const std::string &v, const std::string &f);
+	// Macros defined in both shaders, inserted right after their #version line
+	void setDefines(const std::vector<std::string> &names) { defines = names; }
+	// Vertex shader outputs captured by transform feedback; must be set before init() links
+	void setTransformFeedbackVaryings(const std::vector<std::string> &names, GLenum mode = GL_INTERLEAVED_ATTRIBS)
+	{
+		feedbackVaryings = names;
+		feedbackMode = mode;
+	}
 	virtual bool init();
 	virtual void bind();
 	virtual void unbind();
@@ -29,17 +61,26 @@ public:
 	void addUniform(const std::string &name);
 	GLint getAttribute(const std::string &name) const;
 	GLint getUniform(const std::string &name) const;
+	GLint getUniform(UniformSlot slot) const { return slots[slot]; }
+	static const char *getUniformName(UniformSlot slot);
+
+	// Attach a named uniform block to a buffer binding point; returns false if the program doesn't use it
+	bool bindUniformBlock(const std::string &name, GLuint binding);
 
 protected:
 
 	std::string vShaderName;
 	std::string fShaderName;
+	std::vector<std::string> defines;
+	std::vector<std::string> feedbackVaryings;
+	GLenum feedbackMode = GL_INTERLEAVED_ATTRIBS;
 
 private:
 
 	GLuint pid = 0;
 	std::map<std::string, GLint> attributes;
 	std::map<std::string, GLint> uniforms;
+	GLint slots[UNIFORM_SLOT_COUNT];
 	bool verbose = true;
 
 };
@@ -0,0 +1,209 @@
+#include "ProgramCache.h"
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// glad is generated for core 3.3, so the 4.1 entry points are loaded by hand
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+namespace ProgramCache
+{
+	namespace
+	{
+		const uint32_t MAGIC = 0x47504243; // "CBPG"
+
+		struct Header
+		{
+			uint32_t magic;
+			uint64_t key;
+			uint32_t format;
+			uint32_t length;
+		};
+
+		GetProgramBinaryProc getProgramBinary = nullptr;
+		ProgramBinaryProc programBinary = nullptr;
+		ProgramParameteriProc programParameteri = nullptr;
+		bool supported = false;
+		bool enabled = true;
+		std::string cacheDir;
+		std::string driver;
+		Stats counters;
+
+		// FNV-1a, chained through seed
+		uint64_t hash(const std::string &text, uint64_t seed = 14695981039346656037ull)
+		{
+			uint64_t h = seed;
+			for (unsigned char c : text)
+			{
+				h ^= c;
+				h *= 1099511628211ull;
+			}
+			return h;
+		}
+
+		uint64_t keyFor(const std::string &vSource, const std::string &fSource, const FeedbackLayout &feedback)
+		{
+			// the separator keeps "ab"+"c" and "a"+"bc" apart
+			uint64_t key = hash(fSource + '\0', hash(vSource + '\0', hash(driver + '\0')));
+			for (const std::string &name : feedback.varyings)
+			{
+				key = hash(name + '\0', key);
+			}
+			return feedback.varyings.empty() ? key : hash(std::to_string(feedback.mode), key);
+		}
+
+		std::string pathFor(uint64_t key)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+			return cacheDir + "/" + name;
+		}
+
+		template <typename T>
+		void loadProc(T &proc, const char *name, const char *fallback)
+		{
+			proc = (T)glfwGetProcAddress(name);
+			if (!proc)
+			{
+				proc = (T)glfwGetProcAddress(fallback);
+			}
+		}
+
+		const char *glString(GLenum name)
+		{
+			const GLubyte *s = glGetString(name);
+			return s ? (const char *)s : "";
+		}
+	}
+
+	void init(const std::string &directory)
+	{
+		cacheDir = directory;
+		driver = std::string(glString(GL_VENDOR)) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+		loadProc(getProgramBinary, "glGetProgramBinary", "glGetProgramBinaryARB");
+		loadProc(programBinary, "glProgramBinary", "glProgramBinaryARB");
+		loadProc(programParameteri, "glProgramParameteri", "glProgramParameteriARB");
+
+		GLint formats = 0;
+		if (getProgramBinary && programBinary && programParameteri)
+		{
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			glGetError(); // older drivers may not know the enum
+		}
+		supported = formats > 0;
+		if (!supported)
+		{
+			std::cout << "Program binary cache unavailable: driver reports no binary formats" << std::endl;
+			return;
+		}
+
+#ifdef _WIN32
+		_mkdir(cacheDir.c_str());
+#else
+		mkdir(cacheDir.c_str(), 0755);
+#endif
+	}
+
+	void setEnabled(bool on)
+	{
+		enabled = on;
+	}
+
+	bool isEnabled()
+	{
+		return supported && enabled;
+	}
+
+	const Stats &stats()
+	{
+		return counters;
+	}
+
+	bool load(GLuint program, const std::string &vSource, const std::string &fSource, const FeedbackLayout &feedback)
+	{
+		if (!isEnabled())
+		{
+			return false;
+		}
+
+		uint64_t key = keyFor(vSource, fSource, feedback);
+		std::ifstream file(pathFor(key), std::ios::binary);
+		Header header;
+		if (!file.read((char *)&header, sizeof(header)) || header.magic != MAGIC || header.key != key)
+		{
+			counters.misses++;
+			return false;
+		}
+		std::vector<char> binary(header.length);
+		if (!file.read(binary.data(), binary.size()))
+		{
+			counters.misses++;
+			return false;
+		}
+
+		programBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+		GLint linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		glGetError(); // an unknown format raises GL_INVALID_ENUM; it is only a miss
+		if (!linked)
+		{
+			counters.misses++;
+			return false;
+		}
+		counters.hits++;
+		return true;
+	}
+
+	void prepare(GLuint program)
+	{
+		if (isEnabled())
+		{
+			programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	void store(GLuint program, const std::string &vSource, const std::string &fSource, const FeedbackLayout &feedback)
+	{
+		if (!isEnabled())
+		{
+			return;
+		}
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		getProgramBinary(program, length, &length, &format, binary.data());
+
+		uint64_t key = keyFor(vSource, fSource, feedback);
+		Header header = { MAGIC, key, format, (uint32_t)length };
+		std::ofstream file(pathFor(key), std::ios::binary | std::ios::trunc);
+		file.write((const char *)&header, sizeof(header));
+		file.write(binary.data(), length);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef LAB471_PROGRAMCACHE_H_INCLUDED
+#define LAB471_PROGRAMCACHE_H_INCLUDED
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (GL 4.1 / ARB_get_program_binary). Entries are
+// keyed by a hash of both shader sources, the transform feedback layout set before linking
+// and the GL vendor, renderer and version strings, so editing a shader, capturing different
+// varyings or updating the driver simply misses. A binary the driver rejects
+// is reported as a miss and the caller compiles from source.
+namespace ProgramCache
+{
+	struct Stats
+	{
+		int hits = 0;
+		int misses = 0;
+	};
+
+	// Needs a current context. Leaves the cache disabled when the driver has no binary formats.
+	void init(const std::string &directory);
+	void setEnabled(bool enabled);
+	bool isEnabled();
+	const Stats &stats();
+
+	// Which vertex outputs transform feedback captures, and how; part of the linked binary
+	struct FeedbackLayout
+	{
+		std::vector<std::string> varyings;
+		GLenum mode = GL_INTERLEAVED_ATTRIBS;
+	};
+
+	// Link program from the cached binary for these sources; false if there is none or it is stale
+	bool load(GLuint program, const std::string &vSource, const std::string &fSource, const FeedbackLayout &feedback);
+	// Mark program's binary retrievable; call before glLinkProgram
+	void prepare(GLuint program);
+	// Save the binary of a successfully linked program
+	void store(GLuint program, const std::string &vSource, const std::string &fSource, const FeedbackLayout &feedback);
+}
+
+#endif // LAB471_PROGRAMCACHE_H_INCLUDED
@@ -0,0 +1,182 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "Shape.h"
+#include "Texture.h"
+#include <algorithm>
+#include <cassert>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+    const uint64_t DEPTH_MAX = (1u << 24) - 1;
+
+    // small stable index for a program or texture, assigned on first use
+    template <typename T>
+    uint8_t registryIndex(std::vector<T*>& registry, T* item) {
+        auto it = std::find(registry.begin(), registry.end(), item);
+        if (it != registry.end()) return (uint8_t)(it - registry.begin());
+        assert(registry.size() < 256);
+        registry.push_back(item);
+        return (uint8_t)(registry.size() - 1);
+    }
+}
+
+int RenderQueue::addMaterial(const Material& material) {
+    assert(materials.size() < 256);
+    MaterialEntry entry;
+    entry.material = material;
+    entry.programIndex = registryIndex(programs, material.program.get());
+    entry.textureIndex = registryIndex(textures, material.texture.get());
+    materials.push_back(entry);
+    return (int)materials.size() - 1;
+}
+
+void RenderQueue::begin(const glm::vec3& eye, float farDist) {
+    this->eye = eye;
+    this->farDist = farDist;
+    commands.clear();
+    order.clear();
+    models.clear();
+    callbacks.clear();
+}
+
+uint32_t RenderQueue::addModel(const glm::mat4& model) {
+    models.push_back(model);
+    return (uint32_t)models.size() - 1;
+}
+
+uint32_t RenderQueue::addModels(const glm::mat4* first, int count) {
+    models.insert(models.end(), first, first + count);
+    return (uint32_t)(models.size() - count);
+}
+
+uint64_t RenderQueue::makeKey(Pass pass, int material, GLuint vao, const glm::vec3& position) const {
+    const MaterialEntry& m = materials[material];
+    float t = glm::clamp(glm::distance(position, eye) / farDist, 0.0f, 1.0f);
+    uint64_t depth = (uint64_t)(t * DEPTH_MAX);
+    uint64_t state = ((uint64_t)m.programIndex << 16) | ((uint64_t)m.textureIndex << 8) | (uint64_t)material;
+
+    uint64_t key = (uint64_t)pass << 60;
+    if (pass == PASS_TRANSPARENT) {
+        key |= (DEPTH_MAX - depth) << 36;
+        key |= state << 12;
+    } else {
+        key |= state << 36;
+        key |= depth << 12;
+    }
+    return key | (vao & 0xFFF);
+}
+
+void RenderQueue::push(const DrawCommand& command, const glm::vec3& position) {
+    SortEntry entry;
+    entry.key = makeKey((Pass)command.pass, command.material, command.vao, position);
+    entry.index = (uint32_t)commands.size();
+    commands.push_back(command);
+    order.push_back(entry);
+}
+
+void RenderQueue::submit(Pass pass, int material, GLuint vao, GLsizei indexCount, uint32_t model,
+                         const glm::vec3& position, GLuint condition) {
+    DrawCommand command;
+    command.vao = vao;
+    command.count = indexCount;
+    command.instances = 1;
+    command.model = model;
+    command.condition = condition;
+    command.callback = -1;
+    command.pass = (uint8_t)pass;
+    command.material = (uint8_t)material;
+    command.modelCount = 1;
+    push(command, position);
+}
+
+void RenderQueue::submit(Pass pass, int material, const Shape& shape, const glm::mat4& model) {
+    submit(pass, material, shape.getVAO(), shape.getIndexCount(), addModel(model), glm::vec3(model[3]));
+}
+
+void RenderQueue::submitInstanced(Pass pass, int material, GLuint vao, GLsizei indexCount, GLsizei instanceCount,
+                                  uint32_t model, const glm::vec3& position) {
+    submit(pass, material, vao, indexCount, model, position);
+    commands.back().instances = instanceCount;
+}
+
+void RenderQueue::submitModelArray(Pass pass, int material, GLuint vao, GLsizei indexCount, uint32_t model,
+                                   int modelCount, const glm::vec3& position) {
+    submit(pass, material, vao, indexCount, model, position);
+    commands.back().modelCount = (uint8_t)modelCount;
+}
+
+void RenderQueue::submitCallback(Pass pass, int material, const glm::vec3& position, Callback fn) {
+    DrawCommand command;
+    command.vao = 0;
+    command.count = 0;
+    command.instances = 0;
+    command.model = NO_MODEL;
+    command.condition = 0;
+    command.callback = (int)callbacks.size();
+    command.pass = (uint8_t)pass;
+    command.material = (uint8_t)material;
+    command.modelCount = 0;
+    callbacks.push_back(fn);
+    push(command, position);
+}
+
+void RenderQueue::applyPassState(const PassState& state) {
+    GLState::depthMask(state.depthWrite);
+    GLState::depthFunc(state.depthFunc);
+    GLState::setEnabled(GL_CULL_FACE, state.cullFace);
+    GLState::depthRange(state.depthNear, state.depthFar);
+}
+
+void RenderQueue::execute() {
+    std::sort(order.begin(), order.end());
+
+    int pass = -1;
+    int material = -1;
+    uint32_t model = NO_MODEL;
+    GLint modelLoc = -1;
+    lastSwitches = 0;
+
+    for (const SortEntry& entry : order) {
+        const DrawCommand& command = commands[entry.index];
+        if (command.pass != pass) {
+            pass = command.pass;
+            applyPassState(passStates[pass]);
+        }
+        if (command.material != material) {
+            material = command.material;
+            const Material& m = materials[material].material;
+            m.program->bind();
+            if (m.texture) m.texture->bind(m.program->getUniform(m.sampler));
+            glUniform1f(m.program->getUniform(UNIFORM_MAT_SHINE), m.shine);
+            modelLoc = m.program->getUniform(UNIFORM_M);
+            model = NO_MODEL;
+            lastSwitches++;
+        }
+
+        if (command.callback >= 0) {
+            callbacks[command.callback]();
+            model = NO_MODEL; // the callback may have set its own
+            continue;
+        }
+
+        if (command.model != model) {
+            model = command.model;
+            glUniformMatrix4fv(modelLoc, command.modelCount, GL_FALSE, glm::value_ptr(models[model]));
+        }
+        GLState::bindVertexArray(command.vao);
+        if (command.condition != 0) glBeginConditionalRender(command.condition, GL_QUERY_NO_WAIT);
+        if (command.instances == 1) {
+            glDrawElements(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, 0);
+        } else {
+            glDrawElementsInstanced(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, 0, command.instances);
+        }
+        if (command.condition != 0) glEndConditionalRender();
+    }
+
+    applyPassState(passStates[PASS_OPAQUE]);
+    lastCommands = (int)order.size();
+    order.clear();
+    commands.clear();
+    callbacks.clear();
+    models.clear();
+}
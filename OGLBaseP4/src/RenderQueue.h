@@ -0,0 +1,116 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Program.h"
+
+class Shape;
+class Texture;
+
+// Draws are submitted as small commands with a 64-bit sort key instead of being issued
+// straight away. execute() sorts the frame's commands by key and issues them in one go, so
+// draws sharing a program, texture and VAO run back to back however they were submitted.
+//
+// Key layout, high bits first:
+//   opaque and sky passes   pass:4 | program:8 | texture:8 | material:8 | depth:24 | vao:12
+//   transparent pass        pass:4 | far-to-near depth:24 | program:8 | texture:8 | material:8 | vao:12
+// Every chunk section owns its VAO, so depth sits above the VAO bits: within a material
+// opaque draws run front to back for early-Z rejection, and only the low 12 bits of the VAO
+// name are used to group equal-depth draws.
+class RenderQueue {
+public:
+    // executed in this order
+    enum Pass { PASS_OPAQUE, PASS_HORIZON, PASS_SKY, PASS_TRANSPARENT, PASS_COUNT };
+
+    struct PassState {
+        bool depthWrite = true;
+        GLenum depthFunc = GL_LESS;
+        bool cullFace = true;
+        double depthNear = 0.0, depthFar = 1.0;
+    };
+
+    // Program plus the per-material uniforms set once when the queue switches to it.
+    // Uniforms the program does not have are skipped by GL.
+    struct Material {
+        std::shared_ptr<Program> program;
+        std::shared_ptr<Texture> texture; // may be null
+        UniformSlot sampler = UNIFORM_TEXTURE0;
+        float shine = 0.0f;
+    };
+
+    typedef std::function<void()> Callback;
+    static const uint32_t NO_MODEL = ~0u;
+
+    // at most 256 materials, programs and textures
+    int addMaterial(const Material& material);
+    void setPassState(Pass pass, const PassState& state) { passStates[pass] = state; }
+
+    // Start a frame; depth keys are distances from eye scaled by farDist
+    void begin(const glm::vec3& eye, float farDist);
+    // Model matrices are stored once and shared by every command that names them
+    uint32_t addModel(const glm::mat4& model);
+    // count consecutive matrices, for draws whose program takes M as an array; returns the first
+    uint32_t addModels(const glm::mat4* first, int count);
+    // Indexed triangles from vao; position is the world-space point the draw is depth sorted by.
+    // A non-zero condition query wraps the draw in a no-wait conditional render.
+    void submit(Pass pass, int material, GLuint vao, GLsizei indexCount, uint32_t model,
+                const glm::vec3& position, GLuint condition = 0);
+    void submit(Pass pass, int material, const Shape& shape, const glm::mat4& model);
+    // instanceCount copies of the same draw in one call, for VAOs with per-instance attributes
+    void submitInstanced(Pass pass, int material, GLuint vao, GLsizei indexCount, GLsizei instanceCount,
+                         uint32_t model, const glm::vec3& position);
+    // One draw whose M is the array of modelCount matrices starting at model (from addModels)
+    void submitModelArray(Pass pass, int material, GLuint vao, GLsizei indexCount, uint32_t model,
+                          int modelCount, const glm::vec3& position);
+    // Draws that manage their own buffers; the material is bound before fn runs
+    void submitCallback(Pass pass, int material, const glm::vec3& position, Callback fn);
+
+    // Sort and issue everything submitted since begin(). Leaves the opaque pass state applied.
+    void execute();
+
+    int commandCount() const { return lastCommands; }
+    int materialSwitches() const { return lastSwitches; }
+
+private:
+    struct DrawCommand {
+        GLuint vao;
+        GLsizei count;
+        GLsizei instances;
+        uint32_t model;
+        GLuint condition;
+        int callback; // index into callbacks, or -1
+        uint8_t pass;
+        uint8_t material;
+        uint8_t modelCount;
+    };
+    struct SortEntry {
+        uint64_t key;
+        uint32_t index;
+        bool operator<(const SortEntry& other) const { return key < other.key; }
+    };
+    struct MaterialEntry {
+        Material material;
+        uint8_t programIndex, textureIndex;
+    };
+
+    std::vector<MaterialEntry> materials;
+    std::vector<Program*> programs;
+    std::vector<Texture*> textures;
+    PassState passStates[PASS_COUNT];
+
+    std::vector<DrawCommand> commands;
+    std::vector<SortEntry> order;
+    std::vector<glm::mat4> models;
+    std::vector<Callback> callbacks;
+    glm::vec3 eye;
+    float farDist = 1.0f;
+    int lastCommands = 0;
+    int lastSwitches = 0;
+
+    uint64_t makeKey(Pass pass, int material, GLuint vao, const glm::vec3& position) const;
+    void push(const DrawCommand& command, const glm::vec3& position);
+    static void applyPassState(const PassState& state);
+};
@@ -0,0 +1,46 @@
+#include "ShaderVariants.h"
+#include <iostream>
+
+static const char *FEATURE_NAMES[SHADER_FEATURE_COUNT] = { "FLIP", "TEXTURED", "FOG", "INSTANCED", "RIGGED", "SPIN" };
+
+void ShaderVariants::setShaderNames(const std::string &v, const std::string &f)
+{
+	vShaderName = v;
+	fShaderName = f;
+	variants.clear();
+}
+
+std::shared_ptr<Program> ShaderVariants::get(unsigned features)
+{
+	auto found = variants.find(features);
+	if (found != variants.end())
+	{
+		return found->second;
+	}
+
+	std::vector<std::string> defines;
+	for (int i = 0; i < SHADER_FEATURE_COUNT; i++)
+	{
+		if (features & (1u << i))
+		{
+			defines.push_back(FEATURE_NAMES[i]);
+		}
+	}
+
+	auto prog = std::make_shared<Program>();
+	prog->setVerbose(true);
+	prog->setShaderNames(vShaderName, fShaderName);
+	prog->setDefines(defines);
+	if (!prog->init())
+	{
+		std::cerr << "Could not build variant " << features << " of " << fShaderName << std::endl;
+		prog = nullptr;
+	}
+	else if (setup)
+	{
+		setup(*prog, features);
+	}
+
+	variants[features] = prog;
+	return prog;
+}
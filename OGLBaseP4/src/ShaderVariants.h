@@ -0,0 +1,50 @@
+#pragma once
+#ifndef LAB471_SHADERVARIANTS_H_INCLUDED
+#define LAB471_SHADERVARIANTS_H_INCLUDED
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Program.h"
+
+// Feature bits; a variant key is any combination of them
+enum ShaderFeature
+{
+	SHADER_FLIP = 1 << 0,
+	SHADER_TEXTURED = 1 << 1,
+	SHADER_FOG = 1 << 2,
+	SHADER_INSTANCED = 1 << 3,
+	SHADER_RIGGED = 1 << 4,
+	SHADER_SPIN = 1 << 5,
+	SHADER_FEATURE_COUNT = 6
+};
+
+// One shader pair compiled into specialized programs, one per feature key. Each feature
+// becomes a #define, so the shader resolves it with #ifdef instead of branching on a
+// uniform per fragment, and features a variant leaves out are not compiled at all.
+class ShaderVariants
+{
+
+public:
+
+	// Called on each variant after it links to add its attributes and uniforms
+	typedef std::function<void(Program &, unsigned features)> Setup;
+
+	void setShaderNames(const std::string &v, const std::string &f);
+	void setSetup(const Setup &s) { setup = s; }
+
+	// The program for a key, compiled the first time it is asked for; null if it fails to build
+	std::shared_ptr<Program> get(unsigned features);
+
+private:
+
+	std::string vShaderName;
+	std::string fShaderName;
+	Setup setup;
+	std::map<unsigned, std::shared_ptr<Program>> variants;
+
+};
+
+#endif // LAB471_SHADERVARIANTS_H_INCLUDED
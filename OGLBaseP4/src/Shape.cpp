@@ -1,17 +1,17 @@
 #include "Shape.h"
 #include <iostream>
 #include <assert.h>
+#include <cstddef>
 
 #include "GLSL.h"
+#include "GLState.h"
 #include "Program.h"
 
 using namespace std;
 
 Shape::Shape(bool textured) :
 	eleBufID(0),
-	posBufID(0),
-	norBufID(0),
-	texBufID(0), 
+	vertBufID(0),
     vaoID(0),
     scale(glm::vec3(1.0f)),      // Default scale is 1 (no scaling)
     translation(glm::vec3(0.0f)) // Default translation is at origin
@@ -19,46 +19,37 @@ Shape::Shape(bool textured) :
 	min = glm::vec3(0);
 	max = glm::vec3(0);
 	texOff = !textured;
+	quantized = false;
 	updateModelMatrix(); // Ensure modelMatrix is set correctly
 }
 
 Shape::~Shape()
 {
+	GLState::deleteBuffers(1, &eleBufID);
+	GLState::deleteBuffers(1, &vertBufID);
+	GLState::deleteVertexArrays(1, &vaoID);
 }
 
 /* Copy the data from the shape to this object */
 void Shape::createShape(tinyobj::shape_t &shape)
 {
-	posBuf = shape.mesh.positions;
-	norBuf = shape.mesh.normals;
-	texBuf = shape.mesh.texcoords;
-	eleBuf = shape.mesh.indices;
+	buildMeshData(shape, owned);
+	mesh = viewOf(owned);
+	setBounds(mesh.bounds);
+}
 
-    calculateBoundingSphere();
+void Shape::createShape(const MeshView &view)
+{
+	owned = MeshData();
+	mesh = view;
+	setBounds(mesh.bounds);
 }
 
 /* Compute the bounding box for the shape */
 void Shape::measure() {
-    float minX, minY, minZ;
-    float maxX, maxY, maxZ;
-
-    minX = minY = minZ = 1.1754E+38F;
-    maxX = maxY = maxZ = -1.1754E+38F;
-
-    // Go through all vertices to determine min and max of each dimension
-    for (size_t v = 0; v < posBuf.size() / 3; v++) {
-        if (posBuf[3 * v + 0] < minX) minX = posBuf[3 * v + 0];
-        if (posBuf[3 * v + 0] > maxX) maxX = posBuf[3 * v + 0];
-
-        if (posBuf[3 * v + 1] < minY) minY = posBuf[3 * v + 1];
-        if (posBuf[3 * v + 1] > maxY) maxY = posBuf[3 * v + 1];
-
-        if (posBuf[3 * v + 2] < minZ) minZ = posBuf[3 * v + 2];
-        if (posBuf[3 * v + 2] > maxZ) maxZ = posBuf[3 * v + 2];
-    }
-
-    min = glm::vec3(minX, minY, minZ);
-    max = glm::vec3(maxX, maxY, maxZ);
+    MeshBounds bounds = measureMesh(mesh.vertices, mesh.vertexCount);
+    min = bounds.min;
+    max = bounds.max;
 }
 
 /* Initialize OpenGL buffers */
@@ -66,125 +57,69 @@ void Shape::init()
 {
     // Initialize the vertex array object
     glGenVertexArrays(1, &vaoID);
-    glBindVertexArray(vaoID);
-
-    // Send the position array to the GPU
-    glGenBuffers(1, &posBufID);
-    glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-    glBufferData(GL_ARRAY_BUFFER, posBuf.size() * sizeof(float), &posBuf[0], GL_STATIC_DRAW);
-
-    // Send the normal array to the GPU
-    if (norBuf.empty()) {
-        norBuf.resize(posBuf.size(), 0.0f); // Same size as posBuf, initialized to 0
-
-        for (size_t i = 0; i < eleBuf.size(); i += 3) {
-            // vertex indices
-            unsigned int idx0 = eleBuf[i];
-            unsigned int idx1 = eleBuf[i + 1];
-            unsigned int idx2 = eleBuf[i + 2];
-
-            // vertex positions
-            glm::vec3 v0(posBuf[3 * idx0], posBuf[3 * idx0 + 1], posBuf[3 * idx0 + 2]);
-            glm::vec3 v1(posBuf[3 * idx1], posBuf[3 * idx1 + 1], posBuf[3 * idx1 + 2]);
-            glm::vec3 v2(posBuf[3 * idx2], posBuf[3 * idx2 + 1], posBuf[3 * idx2 + 2]);
-
-            // compute face normal
-            glm::vec3 edge1 = v1 - v0;
-            glm::vec3 edge2 = v2 - v0;
-            glm::vec3 faceNormal = glm::normalize(glm::cross(edge1, edge2));
-
-            // add face normal to each vertex normal
-            for (int j = 0; j < 3; j++) {
-                norBuf[3 * idx0 + j] += faceNormal[j];
-                norBuf[3 * idx1 + j] += faceNormal[j];
-                norBuf[3 * idx2 + j] += faceNormal[j];
-            }
-        }
-
-        // normalize
-        for (size_t i = 0; i < norBuf.size(); i += 3) {
-            glm::vec3 normal(norBuf[i], norBuf[i + 1], norBuf[i + 2]);
-            normal = glm::normalize(normal);
-            norBuf[i] = normal.x;
-            norBuf[i + 1] = normal.y;
-            norBuf[i + 2] = normal.z;
-        }
-    }
-    
-    glGenBuffers(1, &norBufID);
-    glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-    glBufferData(GL_ARRAY_BUFFER, norBuf.size() * sizeof(float), &norBuf[0], GL_STATIC_DRAW);
-    
-
-    // Send the texture array to the GPU - for now no textures
-    if (texBuf.empty() || texOff) {
-        texBufID = 0;
+    GLState::bindVertexArray(vaoID);
+
+    // One interleaved buffer for position, normal and texture coordinates, laid out once in the VAO
+    glGenBuffers(1, &vertBufID);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vertBufID);
+    if (quantized) {
+        std::vector<PackedVertex> packed;
+        quantizeVertices(mesh.vertices, mesh.vertexCount, packed);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (const void *)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (const void *)offsetof(PackedVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (const void *)offsetof(PackedVertex, texCoord));
     } else {
-        glGenBuffers(1, &texBufID);
-        glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-        glBufferData(GL_ARRAY_BUFFER, texBuf.size() * sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * sizeof(MeshVertex), mesh.vertices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void *)offsetof(MeshVertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void *)offsetof(MeshVertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void *)offsetof(MeshVertex, texCoord));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    // untextured shapes leave vertTex at its default of zero
+    if (!texOff) {
+        glEnableVertexAttribArray(2);
     }
 
     // Send the element array to the GPU
     glGenBuffers(1, &eleBufID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf.size() * sizeof(unsigned int), &eleBuf[0], GL_STATIC_DRAW);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * sizeof(unsigned int), mesh.indices, GL_STATIC_DRAW);
 
-    // Unbind the arrays
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    // Unbind the VAO first so it keeps its element buffer
+    GLState::bindVertexArray(0);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
 
     //assert(glGetError() == GL_NO_ERROR);
 }
 
-/* Draw the shape */
-void Shape::draw(const shared_ptr<Program> prog) const
+void Shape::setInstanceAttribute(unsigned location, unsigned buffer, int components, int stride, size_t offset)
 {
-    int h_pos, h_nor, h_tex;
-    h_pos = h_nor = h_tex = -1;
-
-    glBindVertexArray(vaoID);
-
-    // Bind position buffer
-    h_pos = prog->getAttribute("vertPos");
-    GLSL::enableVertexAttribArray(h_pos);
-    glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-    glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-
-    // Bind normal buffer
-    h_nor = prog->getAttribute("vertNor");
-    if (h_nor != -1 && norBufID != 0) {
-        GLSL::enableVertexAttribArray(h_nor);
-        glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-        glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-    }
-
-    if (texBufID != 0) {
-        // Bind texcoords buffer
-        h_tex = prog->getAttribute("vertTex");
-        if (h_tex != -1 && texBufID != 0) {
-            GLSL::enableVertexAttribArray(h_tex);
-            glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-            glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-        }
-    }
-
-    // Bind element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+    GLState::bindVertexArray(vaoID);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
+    GLState::bindVertexArray(0);
+}
 
-    // Draw
-    glDrawElements(GL_TRIANGLES, (int)eleBuf.size(), GL_UNSIGNED_INT, (const void *)0);
+void Shape::setIntegerAttribute(unsigned location, unsigned buffer, int components, unsigned type)
+{
+    GLState::bindVertexArray(vaoID);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribIPointer(location, components, type, 0, (const void *)0);
+    glEnableVertexAttribArray(location);
+    GLState::bindVertexArray(0);
+}
 
-    // Disable and unbind
-    if (h_tex != -1) {
-        GLSL::disableVertexAttribArray(h_tex);
-    }
-    if (h_nor != -1) {
-        GLSL::disableVertexAttribArray(h_nor);
-    }
-    GLSL::disableVertexAttribArray(h_pos);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+/* Draw the shape */
+// Attributes live at the fixed shader locations (vertPos 0, vertNor 1, vertTex 2) and were
+// recorded in the VAO by init(), so drawing only needs the VAO bound.
+void Shape::draw(const shared_ptr<Program> prog) const
+{
+    GLState::bindVertexArray(vaoID);
+    glDrawElements(GL_TRIANGLES, (int)mesh.indexCount, GL_UNSIGNED_INT, (const void *)0);
 }
 
 /* Update the model matrix based on scale and translation */
@@ -192,36 +127,9 @@ void Shape::updateModelMatrix() {
     modelMatrix =  glm::scale(glm::mat4(1.0f), scale) * glm::translate(glm::mat4(1.0f), translation);
 }
 
-void Shape::calculateBoundingSphere() {
-    if (posBuf.empty()) {
-        return;
-    }
-
-    glm::vec3 minPos = glm::vec3(posBuf[0], posBuf[1], posBuf[2]);
-    glm::vec3 maxPos = minPos;
-    glm::vec3 center = glm::vec3(0.0f);
-    size_t numVertices = posBuf.size() / 3;
-
-    // Find the bounding box to get the center and max distance
-    for (size_t i = 0; i < numVertices; ++i) {
-        glm::vec3 vertex(posBuf[i * 3], posBuf[i * 3 + 1], posBuf[i * 3 + 2]);
-        minPos = glm::min(minPos, vertex);
-        maxPos = glm::max(maxPos, vertex);
-        center += vertex;
-    }
-
-    // Compute center and radius
-    center /= float(numVertices);
-    boundingSphere.center = center;
-    boundingSphere.radius = 0.0f;
-
-    for (size_t i = 0; i < numVertices; ++i) {
-        glm::vec3 vertex(posBuf[i * 3], posBuf[i * 3 + 1], posBuf[i * 3 + 2]);
-        float distance = glm::length(vertex - center);
-        boundingSphere.radius = glm::max(boundingSphere.radius, distance);
-    }
-
-    min = minPos;
-    max = maxPos;
+void Shape::setBounds(const MeshBounds &bounds) {
+    boundingSphere.center = bounds.sphereCenter;
+    boundingSphere.radius = bounds.sphereRadius;
+    min = bounds.min;
+    max = bounds.max;
 }
-
@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <tiny_obj_loader/tiny_obj_loader.h>
+#include "MeshData.h"
 
 class Program;
 
@@ -18,8 +19,19 @@ class Shape
 public:
 	Shape(bool textured);
 	virtual ~Shape();
+	// owns its GL buffers, so copies would delete them twice
+	Shape(const Shape &) = delete;
+	Shape &operator=(const Shape &) = delete;
 	void createShape(tinyobj::shape_t & shape);
+	// Use an already interleaved mesh, e.g. from the asset archive; view must outlive init()
+	void createShape(const MeshView &view);
+	// Upload PackedVertex (16 bytes) instead of MeshVertex (32); must be set before init()
+	void setQuantized(bool q) { quantized = q; }
 	void init();
+	// Feed a per-instance attribute from buffer (divisor 1); call after init()
+	void setInstanceAttribute(unsigned location, unsigned buffer, int components, int stride, size_t offset);
+	// Feed an integer per-vertex attribute from a tightly packed buffer of type; call after init()
+	void setIntegerAttribute(unsigned location, unsigned buffer, int components, unsigned type);
 	void measure();
 	void draw(const std::shared_ptr<Program> prog) const;
 
@@ -27,6 +39,9 @@ public:
     glm::mat4 getModelMatrix() const { return modelMatrix; }
     glm::vec3 getScale() const { return scale; }
     glm::vec3 getTranslation() const { return translation; }
+	unsigned getVAO() const { return vaoID; }
+	int getIndexCount() const { return (int)mesh.indexCount; }
+	const MeshView &getMesh() const { return mesh; }
 
     // Setters
     void setScale(const glm::vec3 &s) { scale = s; updateModelMatrix(); }
@@ -44,16 +59,13 @@ public:
     BoundingSphere boundingSphere;
 	
 private:
-	std::vector<unsigned int> eleBuf;
-	std::vector<float> posBuf;
-	std::vector<float> norBuf;
-	std::vector<float> texBuf;
+	MeshData owned; // filled when built from an OBJ shape
+	MeshView mesh;  // what init() uploads: owned, or memory owned by someone else
 	unsigned eleBufID;
-	unsigned posBufID;
-	unsigned norBufID;
-	unsigned texBufID;
+	unsigned vertBufID;
     unsigned vaoID;
 	bool texOff;
+	bool quantized;
 
 	// Transformations
     glm::vec3 scale;
@@ -62,8 +74,8 @@ private:
 
     // Updates the model matrix after transformations
     void updateModelMatrix();
-	
-	void calculateBoundingSphere();
+
+	void setBounds(const MeshBounds &bounds);
 };
 
 #endif
@@ -0,0 +1,250 @@
+#include "SoftwareOcclusion.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCCLUSION_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_LANES 4
+#endif
+
+namespace {
+
+    // boxes with a corner closer than this (in clip w) are not rasterized or tested
+    const float NEAR_W = 0.01f;
+
+#if OCCLUSION_LANES == 8
+    typedef __m256 vfloat;
+    inline vfloat vset(float f) { return _mm256_set1_ps(f); }
+    inline vfloat vramp() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+    inline vfloat vload(const float* p) { return _mm256_loadu_ps(p); }
+    inline void vstore(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+    inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+    inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+    inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+    inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+    inline vfloat vge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    inline vfloat vle(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    inline vfloat vlt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+    inline bool vany(vfloat mask) { return _mm256_movemask_ps(mask) != 0; }
+#elif OCCLUSION_LANES == 4
+    typedef __m128 vfloat;
+    inline vfloat vset(float f) { return _mm_set1_ps(f); }
+    inline vfloat vramp() { return _mm_setr_ps(0, 1, 2, 3); }
+    inline vfloat vload(const float* p) { return _mm_loadu_ps(p); }
+    inline void vstore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+    inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+    inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+    inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+    inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+    inline vfloat vge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+    inline vfloat vle(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+    inline vfloat vlt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+    inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    inline bool vany(vfloat mask) { return _mm_movemask_ps(mask) != 0; }
+#endif
+
+    // edge function E(x, y) = A * x + B * y + C, positive on the inside of a counter-clockwise triangle
+    struct Edge {
+        float A, B, C;
+        Edge(const glm::vec3& p, const glm::vec3& q)
+            : A(p.y - q.y), B(q.x - p.x), C(-(p.y - q.y) * p.x - (q.x - p.x) * p.y) {}
+    };
+
+}
+
+OcclusionRaster::OcclusionRaster() : depth(WIDTH * HEIGHT, 0.0f) {
+}
+
+void OcclusionRaster::clear() {
+    std::fill(depth.begin(), depth.end(), 0.0f);
+}
+
+void OcclusionRaster::setCamera(const glm::mat4& projView, const glm::vec3& eye) {
+    this->projView = projView;
+    this->eye = eye;
+}
+
+// screen x, y in pixels and 1/w, or false when the point is too close to or behind the camera
+bool OcclusionRaster::project(const glm::vec3& p, glm::vec3& screen) const {
+    glm::vec4 clip = projView * glm::vec4(p, 1.0f);
+    if (clip.w < NEAR_W) return false;
+    float invW = 1.0f / clip.w;
+    screen = glm::vec3((clip.x * invW * 0.5f + 0.5f) * WIDTH, (clip.y * invW * 0.5f + 0.5f) * HEIGHT, invW);
+    return true;
+}
+
+void OcclusionRaster::drawOccluder(const glm::vec3& min, const glm::vec3& max) {
+    // corner i has x from bit 0, y from bit 1 and z from bit 2
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        if (!project(p, corners[i])) return;
+    }
+
+    static const int quads[6][4] = {
+        {0, 2, 6, 4}, {1, 3, 7, 5}, // -x, +x
+        {0, 1, 5, 4}, {2, 3, 7, 6}, // -y, +y
+        {0, 1, 3, 2}, {4, 5, 7, 6}  // -z, +z
+    };
+    for (int axis = 0; axis < 3; axis++) {
+        int face = -1;
+        if (eye[axis] < min[axis]) face = axis * 2;
+        else if (eye[axis] > max[axis]) face = axis * 2 + 1;
+        if (face < 0) continue;
+        const int* q = quads[face];
+        drawTriangle(corners[q[0]], corners[q[1]], corners[q[2]]);
+        drawTriangle(corners[q[0]], corners[q[2]], corners[q[3]]);
+    }
+}
+
+void OcclusionRaster::drawTriangle(const glm::vec3& a, const glm::vec3& b0, const glm::vec3& c0) {
+    glm::vec3 b = b0, c = c0;
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area == 0.0f) return;
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    int minX = std::max(0, (int)std::floor(std::min(a.x, std::min(b.x, c.x))));
+    int maxX = std::min(WIDTH - 1, (int)std::ceil(std::max(a.x, std::max(b.x, c.x))));
+    int minY = std::max(0, (int)std::floor(std::min(a.y, std::min(b.y, c.y))));
+    int maxY = std::min(HEIGHT - 1, (int)std::ceil(std::max(a.y, std::max(b.y, c.y))));
+    if (minX > maxX || minY > maxY) return;
+
+    // e0 weights a, e1 weights b, e2 weights c; 1/w is a plane over the screen
+    Edge e0(b, c), e1(c, a), e2(a, b);
+    float zA = (e0.A * a.z + e1.A * b.z + e2.A * c.z) / area;
+    float zB = (e0.B * a.z + e1.B * b.z + e2.B * c.z) / area;
+    float zC = (e0.C * a.z + e1.C * b.z + e2.C * c.z) / area;
+
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        float* row = &depth[y * WIDTH];
+#ifdef OCCLUSION_LANES
+        // rows start on a lane boundary; lanes outside the triangle fail the edge tests
+        vfloat ramp = vramp(), zero = vset(0.0f);
+        vfloat A0 = vset(e0.A), A1 = vset(e1.A), A2 = vset(e2.A), AZ = vset(zA);
+        vfloat R0 = vset(e0.B * py + e0.C), R1 = vset(e1.B * py + e1.C), R2 = vset(e2.B * py + e2.C);
+        vfloat RZ = vset(zB * py + zC);
+        for (int x = minX & ~(OCCLUSION_LANES - 1); x <= maxX; x += OCCLUSION_LANES) {
+            vfloat px = vadd(ramp, vset(x + 0.5f));
+            vfloat inside = vand(vand(
+                vge(vadd(vmul(A0, px), R0), zero),
+                vge(vadd(vmul(A1, px), R1), zero)),
+                vge(vadd(vmul(A2, px), R2), zero));
+            vfloat z = vadd(vmul(AZ, px), RZ);
+            vfloat d = vload(row + x);
+            vstore(row + x, vselect(inside, vmax(d, z), d));
+        }
+#else
+        for (int x = minX; x <= maxX; x++) {
+            float px = x + 0.5f;
+            if (e0.A * px + e0.B * py + e0.C < 0 || e1.A * px + e1.B * py + e1.C < 0 ||
+                e2.A * px + e2.B * py + e2.C < 0) continue;
+            row[x] = std::max(row[x], zA * px + zB * py + zC);
+        }
+#endif
+    }
+}
+
+bool OcclusionRaster::testAABB(const glm::vec3& min, const glm::vec3& max) const {
+    glm::vec2 lo(1e9f), hi(-1e9f);
+    float nearest = 0.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        glm::vec3 s;
+        if (!project(p, s)) return true;
+        lo = glm::min(lo, glm::vec2(s.x, s.y));
+        hi = glm::max(hi, glm::vec2(s.x, s.y));
+        nearest = std::max(nearest, s.z);
+    }
+
+    int minX = std::max(0, (int)std::floor(lo.x));
+    int maxX = std::min(WIDTH - 1, (int)std::floor(hi.x));
+    int minY = std::max(0, (int)std::floor(lo.y));
+    int maxY = std::min(HEIGHT - 1, (int)std::floor(hi.y));
+    if (minX > maxX || minY > maxY) return true; // off screen, left to frustum culling
+
+    for (int y = minY; y <= maxY; y++) {
+        const float* row = &depth[y * WIDTH];
+#ifdef OCCLUSION_LANES
+        vfloat ramp = vramp(), boxNear = vset(nearest);
+        vfloat left = vset((float)minX), right = vset((float)maxX);
+        for (int x = minX & ~(OCCLUSION_LANES - 1); x <= maxX; x += OCCLUSION_LANES) {
+            vfloat px = vadd(ramp, vset((float)x));
+            vfloat inRect = vand(vge(px, left), vle(px, right));
+            if (vany(vand(inRect, vlt(vload(row + x), boxNear)))) return true;
+        }
+#else
+        for (int x = minX; x <= maxX; x++) {
+            if (row[x] < nearest) return true;
+        }
+#endif
+    }
+    return false;
+}
+
+void SoftwareOcclusion::start(ThreadPool& pool, const std::unordered_map<ChunkCoord, ChunkMesh*>& meshes,
+                              const glm::mat4& projView, const glm::vec3& eye) {
+    if (job.valid()) job.wait();
+
+    boxes.clear();
+    SectionMask all = SectionMask().set();
+    for (const auto& pair : meshes) {
+        ChunkBox box;
+        box.coord = pair.first;
+        box.mesh = pair.second;
+        if (!pair.second->sectionBounds(all, box.min, box.max)) continue;
+        glm::vec3 center = (box.min + box.max) * 0.5f;
+        box.distance = glm::length(glm::vec2(center.x - eye.x, center.z - eye.z));
+        boxes.push_back(box);
+    }
+
+    job = pool.submit([this, projView, eye]() { run(projView, eye); });
+}
+
+bool SoftwareOcclusion::finish() {
+    if (!job.valid()) return false;
+    job.get();
+    return true;
+}
+
+void SoftwareOcclusion::run(glm::mat4 projView, glm::vec3 eye) {
+    auto begin = std::chrono::high_resolution_clock::now();
+
+    raster.clear();
+    raster.setCamera(projView, eye);
+
+    // nearby terrain hides the most, so only the closest chunks are drawn as occluders
+    int occluders = std::min<int>(occluderChunks, boxes.size());
+    std::partial_sort(boxes.begin(), boxes.begin() + occluders, boxes.end(),
+        [](const ChunkBox& a, const ChunkBox& b) { return a.distance < b.distance; });
+    for (int i = 0; i < occluders; i++) {
+        const ChunkBox& box = boxes[i];
+        const int* heights = box.mesh->getOccluderHeights();
+        glm::vec3 origin(box.coord.x * CHUNK_SIZE, 0, box.coord.z * CHUNK_SIZE);
+        for (int cz = 0; cz < OCCLUDER_CELLS; cz++) {
+            for (int cx = 0; cx < OCCLUDER_CELLS; cx++) {
+                int height = heights[cz * OCCLUDER_CELLS + cx];
+                if (height == 0) continue;
+                glm::vec3 min = origin + glm::vec3(cx * OCCLUDER_CELL, 0, cz * OCCLUDER_CELL);
+                raster.drawOccluder(min, min + glm::vec3(OCCLUDER_CELL, height, OCCLUDER_CELL));
+            }
+        }
+    }
+
+    hidden.clear();
+    for (const ChunkBox& box : boxes) {
+        // the camera's own chunk is always drawn
+        if (eye.x >= box.min.x - 1 && eye.x <= box.max.x + 1 && eye.z >= box.min.z - 1 && eye.z <= box.max.z + 1) continue;
+        if (!raster.testAABB(box.min, box.max)) hidden.insert(box.coord);
+    }
+
+    ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ChunkSystem.h"
+#include "ChunkMesh.h"
+#include "ThreadPool.h"
+
+// Low resolution CPU depth buffer. Occluder boxes are rasterized into it and boxes are
+// tested against it; stored values are 1/w, so larger is nearer and 0 is empty. Rows are
+// processed 8 (AVX2) or 4 (SSE2) pixels at a time, with a scalar fallback elsewhere.
+class OcclusionRaster {
+public:
+    enum { WIDTH = 256, HEIGHT = 128 };
+
+    OcclusionRaster();
+    void clear();
+    void setCamera(const glm::mat4& projView, const glm::vec3& eye);
+    // Solid box; only its faces towards the camera are drawn. Boxes crossing the near
+    // plane are skipped, which keeps the buffer conservative.
+    void drawOccluder(const glm::vec3& min, const glm::vec3& max);
+    // False only when every pixel under the box is covered by something nearer than it
+    bool testAABB(const glm::vec3& min, const glm::vec3& max) const;
+
+private:
+    std::vector<float> depth;
+    glm::mat4 projView;
+    glm::vec3 eye;
+
+    bool project(const glm::vec3& p, glm::vec3& screen) const;
+    void drawTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+};
+
+// Per-frame CPU occlusion pass over the loaded chunks. start() snapshots the chunk bounds
+// on the render thread and rasterizes on a worker while the frame's other draws are
+// issued; finish() waits for it before the chunks are drawn.
+class SoftwareOcclusion {
+public:
+    bool enabled = true;
+    int occluderChunks = 96; // nearest chunks whose terrain is drawn as occluders
+
+    void start(ThreadPool& pool, const std::unordered_map<ChunkCoord, ChunkMesh*>& meshes,
+               const glm::mat4& projView, const glm::vec3& eye);
+    // Returns false when no pass was started this frame
+    bool finish();
+    bool isHidden(const ChunkCoord& coord) const { return hidden.count(coord) > 0; }
+    int hiddenCount() const { return hidden.size(); }
+    double lastMs() const { return ms; }
+
+private:
+    struct ChunkBox {
+        ChunkCoord coord;
+        const ChunkMesh* mesh;
+        glm::vec3 min, max;
+        float distance;
+    };
+
+    OcclusionRaster raster;
+    std::vector<ChunkBox> boxes;
+    std::unordered_set<ChunkCoord> hidden;
+    std::future<void> job;
+    double ms = 0.0;
+
+    void run(glm::mat4 projView, glm::vec3 eye);
+};
@@ -0,0 +1,4 @@
+// stb_image's implementation, in a file of its own so that the build can relax warnings for
+// the library without relaxing them for ImageData
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
@@ -1,16 +1,18 @@
 #include "Texture.h"
 #include "GLSL.h"
+#include "GLState.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
 Texture::Texture() :
 	filename(""),
-	tid(0)
+	tid(0),
+	unit(0),
+	target(GL_TEXTURE_2D)
 {
 	
 }
@@ -20,37 +22,99 @@ Texture::~Texture()
 	
 }
 
+// 2D textures are uploaded bottom row first, as GL expects; cube map faces keep the
+// file's top-down order, which is how the face images are laid out
+vector<string> Texture::sources() const
+{
+	return target == GL_TEXTURE_CUBE_MAP ? cubeFaces : vector<string>(1, filename);
+}
+
+void Texture::startDecode(ThreadPool &pool)
+{
+	bool bottomUp = target == GL_TEXTURE_2D;
+	for (const string &file : sources())
+	{
+		pending.push_back(pool.submit([file, bottomUp]() {
+			ImageData image;
+			loadImage(file, bottomUp, image);
+			return image;
+		}));
+	}
+}
+
 void Texture::init()
 {
-	// Load texture
-	int w, h, ncomps;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char *data = stbi_load(filename.c_str(), &w, &h, &ncomps, 0);
-	if(!data) {
-		cerr << filename << " not found" << endl;
+	vector<string> files = sources();
+	vector<ImageData> images(files.size());
+	if (pending.size() == files.size())
+	{
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			images[i] = pending[i].get();
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			loadImage(files[i], target == GL_TEXTURE_2D, images[i]);
+		}
+	}
+	pending.clear();
+
+	// RGB rows of small mips are not 4-byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (target == GL_TEXTURE_CUBE_MAP)
+	{
+		uploadCubeMap(images);
+	}
+	else
+	{
+		upload2D(images[0]);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void Texture::upload2D(const ImageData &image)
+{
+	int ncomps = image.channels;
+	if (image.empty()) {
+		cerr << filename << " could not be loaded" << endl;
 	}
-	if (ncomps != 3 && ncomps != 4) {
+	else if (ncomps != 3 && ncomps != 4) {
 		cerr << filename << " must have 3 or 4 components (RGB or RGBA)" << endl;
 	}
-	if((w & (w - 1)) != 0 || (h & (h - 1)) != 0) {
+	width = image.width();
+	height = image.height();
+	if((width & (width - 1)) != 0 || (height & (height - 1)) != 0) {
 		cerr << filename << " must be a power of 2" << endl;
 	}
-	width = w;
-	height = h;
 
 	// Generate a texture buffer object
 	glGenTextures(1, &tid);
 	// Bind the current texture to be the newly generated texture object
-	glBindTexture(GL_TEXTURE_2D, tid);
+	GLState::bindTexture(0, GL_TEXTURE_2D, tid);
+	if (image.empty()) {
+		return;
+	}
 	// Load the actual texture data
 	// Base level is 0, number of channels is 3, and border is 0.
 	GLenum format = (ncomps == 4) ? GL_RGBA : GL_RGB;
 	GLenum internalFormat = (ncomps == 4) ? GL_SRGB_ALPHA : GL_RGB;
-	
-	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-	
-	// Generate image pyramid
-	glGenerateMipmap(GL_TEXTURE_2D);
+
+	int levels = (int)image.levels.size();
+	for (int i = 0; i < levels; i++) {
+		const ImageData::Level &l = image.levels[i];
+		glTexImage2D(GL_TEXTURE_2D, i, internalFormat, l.width, l.height, 0, format, GL_UNSIGNED_BYTE, image.level(i));
+	}
+
+	if (levels > 1) {
+		// baked mip chain, already complete
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	} else {
+		// Generate image pyramid
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
 	// Set texture wrap modes for the S and T directions
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -58,47 +122,50 @@ void Texture::init()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	// Unbind
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// Free image, since the data is now on the GPU
-	stbi_image_free(data);
+	GLState::bindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 void Texture::setWrapModes(GLint wrapS, GLint wrapT)
 {
 	// Must be called after init()
-	glBindTexture(GL_TEXTURE_2D, tid);
+	GLState::bindTexture(0, GL_TEXTURE_2D, tid);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
 }
 
 void Texture::bind(GLint handle)
 {
-	glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(GL_TEXTURE_2D, tid);
-	glUniform1i(handle, unit);
+	GLState::bindTexture(unit, target, tid);
+	GLState::setSampler(handle, unit);
 }
 
 void Texture::unbind()
 {
-	glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::bindTexture(unit, target, 0);
+}
+
+void Texture::setCubeMapFaces(const std::vector<std::string>& faces) {
+	target = GL_TEXTURE_CUBE_MAP;
+	cubeFaces = faces;
 }
 
 void Texture::loadCubeMap(const std::vector<std::string>& faces) {
+	setCubeMapFaces(faces);
+	init();
+}
+
+void Texture::uploadCubeMap(const std::vector<ImageData>& faces) {
 	glGenTextures(1, &tid);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, tid);
+	GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, tid);
 
-	int width, height, nrChannels;
-	
 	for (unsigned int i = 0; i < faces.size(); i++) {
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data) {
-			flipImageVertically(data, width, height, nrChannels); // Flip the texture
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
+		const ImageData& face = faces[i];
+		if (!face.empty()) {
+			// the faces are only sampled with GL_LINEAR, so baked mips beyond level 0 go unused
+			GLenum format = face.channels == 4 ? GL_RGBA : GL_RGB;
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, face.width(), face.height(), 0, format, GL_UNSIGNED_BYTE, face.level(0));
 		} else {
-			std::cerr << "Failed to load cubemap texture: " << faces[i] << std::endl;
-			stbi_image_free(data);
+			std::cerr << "Failed to load cubemap texture: " << cubeFaces[i] << std::endl;
 		}
 	}
 
@@ -108,18 +175,3 @@ void Texture::loadCubeMap(const std::vector<std::string>& faces) {
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 }
-
-void Texture::flipImageVertically(unsigned char* image, int width, int height, int channels) {
-    int rowSize = width * channels;  
-    unsigned char* tempRow = new unsigned char[rowSize];  
-
-    for (int i = 0; i < height / 2; i++) {
-        unsigned char* row1 = image + i * rowSize;
-        unsigned char* row2 = image + (height - i - 1) * rowSize;
-        memcpy(tempRow, row1, rowSize);
-        memcpy(row1, row2, rowSize);
-        memcpy(row2, tempRow, rowSize);
-    }
-
-    delete[] tempRow;
-}
\ No newline at end of file
@@ -3,7 +3,12 @@
 #define __Texture__
 
 #include <glad/glad.h>
+#include <future>
 #include <string>
+#include <vector>
+#include "ImageData.h"
+
+class ThreadPool;
 
 class Texture
 {
@@ -11,6 +16,8 @@ public:
 	Texture();
 	virtual ~Texture();
 	void setFilename(const std::string &f) { filename = f; }
+	// Decode (or read the baked mip chain) on pool's workers; init() then only waits and uploads
+	void startDecode(ThreadPool &pool);
 	void init();
 	void setUnit(GLint u) { unit = u; }
 	GLint getUnit() const { return unit; }
@@ -18,14 +25,21 @@ public:
 	void unbind();
 	void setWrapModes(GLint wrapS, GLint wrapT); // Must be called after init()
 	GLint getID() const { return tid;}
+	// Six faces in +x, -x, +y, -y, +z, -z order; loadCubeMap decodes and uploads in place
+	void setCubeMapFaces(const std::vector<std::string>& faces);
 	void loadCubeMap(const std::vector<std::string>& faces);
 private:
 	std::string filename;
+	std::vector<std::string> cubeFaces;
+	std::vector<std::future<ImageData>> pending; // one per file while decoding on a worker
 	int width;
 	int height;
 	GLuint tid;
 	GLint unit;
-	void flipImageVertically(unsigned char* image, int width, int height, int channels);
+	GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+	std::vector<std::string> sources() const;
+	void upload2D(const ImageData &image);
+	void uploadCubeMap(const std::vector<ImageData> &faces);
 };
 
 #endif
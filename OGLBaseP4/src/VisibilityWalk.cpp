@@ -0,0 +1,50 @@
+#include "VisibilityWalk.h"
+#include <cmath>
+
+bool VisibilityWalk::run(const std::unordered_map<ChunkCoord, ChunkMesh*>& meshes, const glm::vec3& eye) {
+    reached.clear();
+    queue.clear();
+    visited = 0;
+
+    ChunkCoord start = {
+        static_cast<int>(floor(eye.x / CHUNK_SIZE)),
+        static_cast<int>(floor(eye.z / CHUNK_SIZE))
+    };
+    int startSection = static_cast<int>(floor(eye.y / SECTION_SIZE));
+    active = startSection >= 0 && startSection < SECTIONS_PER_CHUNK && meshes.count(start) > 0;
+    if (!active) return false;
+
+    reached[start].set(startSection);
+    queue.push_back({start, startSection, -1, 0});
+
+    for (size_t head = 0; head < queue.size(); head++) {
+        Step step = queue[head];
+        const ChunkMesh* mesh = meshes.at(step.chunk);
+
+        for (int face = 0; face < 6; face++) {
+            int opposite = face ^ 1;
+            if (step.directions & (1 << opposite)) continue;
+            if (step.entryFace >= 0 && !mesh->facesConnected(step.section, step.entryFace, face)) continue;
+
+            const int* d = ChunkMesher::FACE_OFFSETS[face];
+            ChunkCoord next = {step.chunk.x + d[0], step.chunk.z + d[2]};
+            int nextSection = step.section + d[1];
+            if (nextSection < 0 || nextSection >= SECTIONS_PER_CHUNK) continue;
+            if (meshes.find(next) == meshes.end()) continue;
+
+            SectionMask& mask = reached[next];
+            if (mask.test(nextSection)) continue;
+            mask.set(nextSection);
+            queue.push_back({next, nextSection, opposite, step.directions | (1 << face)});
+        }
+    }
+
+    visited = queue.size();
+    return true;
+}
+
+SectionMask VisibilityWalk::visibleSections(const ChunkCoord& coord) const {
+    if (!active) return SectionMask().set();
+    auto it = reached.find(coord);
+    return it != reached.end() ? it->second : SectionMask();
+}
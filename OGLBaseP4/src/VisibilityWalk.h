@@ -0,0 +1,29 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ChunkSystem.h"
+#include "ChunkMesh.h"
+
+// Occlusion culling over the section connectivity graph: a breadth-first walk from the
+// camera's section that only steps through faces the air inside each section connects.
+class VisibilityWalk {
+public:
+    // Returns false, leaving every section visible, when the camera is outside the loaded sections
+    bool run(const std::unordered_map<ChunkCoord, ChunkMesh*>& meshes, const glm::vec3& eye);
+    SectionMask visibleSections(const ChunkCoord& coord) const;
+    int visitedCount() const { return visited; }
+
+private:
+    struct Step {
+        ChunkCoord chunk;
+        int section;
+        int entryFace;  // face we came in through, -1 for the camera section
+        int directions; // faces stepped out of so far, the walk never turns back
+    };
+
+    bool active = false;
+    int visited = 0;
+    std::unordered_map<ChunkCoord, SectionMask> reached;
+    std::vector<Step> queue;
+};
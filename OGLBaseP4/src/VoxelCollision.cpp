@@ -0,0 +1,158 @@
+#include "VoxelCollision.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <future>
+#include "ChunkData.h"
+#include "ThreadPool.h"
+#include "World.h"
+
+namespace {
+    // faces closer than this count as touching rather than overlapping
+    const float EPSILON = 1e-4f;
+    const size_t MIN_SLICE = 256;
+
+    int floorToInt(float v) { return (int)std::floor(v); }
+    int ceilToInt(float v) { return (int)std::ceil(v); }
+}
+
+VoxelCollider::Cursor::Cursor(World& w) : world(w), chunkX(INT_MIN), chunkZ(INT_MIN), chunk(nullptr) {}
+
+bool VoxelCollider::Cursor::solid(int x, int y, int z) {
+    if (y < 0 || y >= CHUNK_HEIGHT) return false;
+    int cx = floorToInt((float)x / CHUNK_SIZE), cz = floorToInt((float)z / CHUNK_SIZE);
+    if (cx != chunkX || cz != chunkZ) {
+        chunkX = cx;
+        chunkZ = cz;
+        chunk = world.getChunk(ChunkCoord{cx, cz});
+    }
+    if (!chunk) return false;
+    return chunk->getVoxels().get(x - cx * CHUNK_SIZE, y, z - cz * CHUNK_SIZE) != 0;
+}
+
+// How far box can move along axis, up to delta
+float VoxelCollider::sweepAxis(Cursor& cursor, const AABB& box, int axis, float delta) {
+    if (delta == 0.0f) return 0.0f;
+    int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+    // cross-section cells, not counting faces the box only touches
+    int lo1 = floorToInt(box.min[a1] + EPSILON), hi1 = ceilToInt(box.max[a1] - EPSILON) - 1;
+    int lo2 = floorToInt(box.min[a2] + EPSILON), hi2 = ceilToInt(box.max[a2] - EPSILON) - 1;
+
+    // layers of cells the leading face passes, nearest first, skipping any it already overlaps
+    int first, last, step;
+    if (delta > 0.0f) {
+        first = ceilToInt(box.max[axis] - EPSILON);
+        last = ceilToInt(box.max[axis] + delta) - 1;
+        step = 1;
+    } else {
+        first = floorToInt(box.min[axis] + EPSILON) - 1;
+        last = floorToInt(box.min[axis] + delta);
+        step = -1;
+    }
+
+    int cell[3];
+    for (int layer = first; step > 0 ? layer <= last : layer >= last; layer += step) {
+        cell[axis] = layer;
+        for (int i = lo1; i <= hi1; i++) {
+            cell[a1] = i;
+            for (int j = lo2; j <= hi2; j++) {
+                cell[a2] = j;
+                if (cursor.solid(cell[0], cell[1], cell[2])) {
+                    return step > 0 ? std::max(0.0f, layer - box.max[axis])
+                                    : std::min(0.0f, layer + 1 - box.min[axis]);
+                }
+            }
+        }
+    }
+    return delta;
+}
+
+glm::vec3 VoxelCollider::sweep(const AABB& box, const glm::vec3& delta, uint8_t* hits) const {
+    static const int ORDER[3] = {1, 0, 2};
+    static const uint8_t BITS[3] = {HIT_X, HIT_Y, HIT_Z};
+    Cursor cursor(world);
+    AABB moving = box;
+    glm::vec3 moved(0.0f);
+    uint8_t blocked = 0;
+    for (int axis : ORDER) {
+        float d = sweepAxis(cursor, moving, axis, delta[axis]);
+        if (d != delta[axis]) blocked |= BITS[axis];
+        moving.min[axis] += d;
+        moving.max[axis] += d;
+        moved[axis] = d;
+    }
+    if (hits) *hits = blocked;
+    return moved;
+}
+
+bool VoxelCollider::overlaps(const AABB& box) const {
+    Cursor cursor(world);
+    int x0 = floorToInt(box.min.x + EPSILON), x1 = ceilToInt(box.max.x - EPSILON) - 1;
+    int y0 = floorToInt(box.min.y + EPSILON), y1 = ceilToInt(box.max.y - EPSILON) - 1;
+    int z0 = floorToInt(box.min.z + EPSILON), z1 = ceilToInt(box.max.z - EPSILON) - 1;
+    for (int x = x0; x <= x1; x++) {
+        for (int z = z0; z <= z1; z++) {
+            for (int y = y0; y <= y1; y++) {
+                if (cursor.solid(x, y, z)) return true;
+            }
+        }
+    }
+    return false;
+}
+
+void VoxelCollider::sweepAll(std::vector<Body>& bodies, ThreadPool* pool) const {
+    size_t count = bodies.size();
+    auto run = [this, &bodies](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Body& body = bodies[i];
+            body.moved = sweep(body.box, body.delta, &body.hits);
+        }
+    };
+
+    size_t jobs = pool ? std::min<size_t>(pool->size() + 1, std::max<size_t>(1, count / MIN_SLICE)) : 1;
+    size_t slice = (count + jobs - 1) / jobs;
+    std::vector<std::future<void>> pending;
+    for (size_t j = 1; j < jobs; j++) {
+        size_t begin = std::min(count, j * slice), end = std::min(count, begin + slice);
+        pending.push_back(pool->submit([run, begin, end]() { run(begin, end); }));
+    }
+    run(0, std::min(count, slice));
+    for (std::future<void>& job : pending) job.get();
+}
+
+void VoxelSnapshot::capture(World& world, const glm::ivec3& lo, const glm::ivec3& hi) {
+    int y0 = std::max(lo.y, 0), y1 = std::min(hi.y, CHUNK_HEIGHT - 1);
+    if (hi.x < lo.x || hi.z < lo.z || y1 < y0) {
+        clear();
+        return;
+    }
+    origin = glm::ivec3(lo.x, y0, lo.z);
+    size = glm::ivec3(hi.x - lo.x + 1, y1 - y0 + 1, hi.z - lo.z + 1);
+    cells.assign((size_t)size.x * size.y * size.z, 0);
+
+    int chunkX = INT_MIN, chunkZ = INT_MIN;
+    const ChunkData* chunk = nullptr;
+    uint8_t* column = cells.data();
+    for (int x = lo.x; x <= hi.x; x++) {
+        for (int z = lo.z; z <= hi.z; z++, column += size.y) {
+            int cx = floorToInt((float)x / CHUNK_SIZE), cz = floorToInt((float)z / CHUNK_SIZE);
+            if (cx != chunkX || cz != chunkZ) {
+                chunkX = cx;
+                chunkZ = cz;
+                chunk = world.getChunk(ChunkCoord{cx, cz});
+            }
+            if (!chunk) continue;
+            const auto& voxels = chunk->getVoxels();
+            int lx = x - cx * CHUNK_SIZE, lz = z - cz * CHUNK_SIZE;
+            for (int y = y0; y <= y1; y++) {
+                column[y - y0] = voxels.get(lx, y, lz) != 0;
+            }
+        }
+    }
+}
+
+void VoxelSnapshot::clear() {
+    origin = glm::ivec3(0);
+    size = glm::ivec3(0);
+    cells.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ChunkData;
+class ThreadPool;
+class World;
+
+struct AABB {
+    glm::vec3 min, max;
+};
+
+// Swept axis-aligned boxes against the solid blocks of a World. A move is resolved one axis
+// at a time, y then x then z: along each axis the box is stopped at the face of the first
+// solid block it would sweep into, so a body slides along walls and lands on the ground.
+// Blocks the box already overlaps are ignored, which lets anything stuck inside terrain move
+// out. Blocks are read from chunk storage, with the chunk looked up once per column.
+// Unloaded chunks are empty. The World must not change while queries run.
+class VoxelCollider {
+public:
+    enum Hit : uint8_t { HIT_X = 1, HIT_Y = 2, HIT_Z = 4 };
+
+    // One body of a batch: box and delta in, the displacement actually applied and the axes
+    // that were blocked out
+    struct Body {
+        AABB box;
+        glm::vec3 delta;
+        glm::vec3 moved;
+        uint8_t hits;
+    };
+
+    explicit VoxelCollider(World& world) : world(world) {}
+
+    // Displacement that moves box by delta as far as the terrain allows; hits gets Hit bits
+    glm::vec3 sweep(const AABB& box, const glm::vec3& delta, uint8_t* hits = nullptr) const;
+    bool overlaps(const AABB& box) const;
+    // Sweep every body, in slices over pool's workers when one is given
+    void sweepAll(std::vector<Body>& bodies, ThreadPool* pool) const;
+
+private:
+    World& world;
+
+    // Caches the chunk of the last column read, so runs of blocks cost one lookup
+    struct Cursor {
+        World& world;
+        int chunkX, chunkZ;
+        const ChunkData* chunk;
+        explicit Cursor(World& w);
+        bool solid(int x, int y, int z);
+    };
+
+    static float sweepAxis(Cursor& cursor, const AABB& box, int axis, float delta);
+};
+
+// Solidity of every block in a box of the world, copied out of chunk storage in one pass
+// with one chunk lookup per column. Afterwards a point query is a bounds check and a byte
+// read, so large batches of points (particles) can test the terrain without touching the
+// World, from any thread, while the World changes. Blocks outside the box read as air.
+class VoxelSnapshot {
+public:
+    // Copy the blocks from lo to hi inclusive, reusing the storage of earlier captures
+    void capture(World& world, const glm::ivec3& lo, const glm::ivec3& hi);
+    void clear();
+
+    // Whether the block containing the point is solid
+    bool solid(float x, float y, float z) const {
+        float dx = x - origin.x, dy = y - origin.y, dz = z - origin.z;
+        if (!(dx >= 0.0f && dx < size.x && dy >= 0.0f && dy < size.y && dz >= 0.0f && dz < size.z)) return false;
+        return cells[((size_t)dx * size.z + (size_t)dz) * size.y + (size_t)dy] != 0;
+    }
+    size_t volume() const { return cells.size(); }
+
+private:
+    glm::ivec3 origin = glm::ivec3(0);
+    glm::ivec3 size = glm::ivec3(0);
+    std::vector<uint8_t> cells; // one per block, columns contiguous
+};
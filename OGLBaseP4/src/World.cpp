@@ -1,6 +1,7 @@
 #include "World.h"
 #include <cstdlib>
 #include <iostream>
+#include <tuple>
 
 std::unordered_map<ChunkCoord, ChunkData> World::chunks;
 int World::seed = 0;
@@ -50,6 +51,18 @@ void World::setBlock(int x, int y, int z, int blockType) {
     if(chunk != nullptr)
     {
         chunk->setBlock(localX, y, localZ, blockType);
+        if (onBlockChanged) onBlockChanged(x, y, z);
+    }
+}
+
+// Flag the section holding a world position for remeshing
+void World::markSectionDirty(int x, int y, int z) {
+    if(y < 0 || y >= CHUNK_HEIGHT) return;
+
+    ChunkData* chunk = getChunk(worldToChunk(x, z));
+    if(chunk != nullptr)
+    {
+        chunk->markSectionDirty(y / SECTION_SIZE);
     }
 }
 
@@ -64,6 +77,8 @@ void World::addChunk(const ChunkCoord& coord) {
     // Check if the chunk already exists
     if(chunks.find(coord) == chunks.end()) {
         // Add the chunk with appropriate initialization
-        chunks.emplace(coord, ChunkData(coord.x, coord.z, this, World::seed));
+        chunks.emplace(std::piecewise_construct,
+                       std::forward_as_tuple(coord),
+                       std::forward_as_tuple(coord.x, coord.z, this, World::seed));
     }
 }
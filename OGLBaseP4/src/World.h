@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <vector>
 #include "GLSL.h"
 #include <glm/gtc/type_ptr.hpp>
@@ -10,10 +11,13 @@ class World {
     static std::unordered_map<ChunkCoord, ChunkData> chunks;
 public:
     static int seed;
+    // Called after setBlock changes a block, e.g. to keep navigation data current
+    std::function<void(int, int, int)> onBlockChanged;
     ChunkCoord worldToChunk(int worldX, int worldZ);
     int getBlock(int x, int y, int z);
     int getBlock(glm::vec3 pos);
     void setBlock(int x, int y, int z, int blockType);
+    void markSectionDirty(int x, int y, int z);
     ChunkData* getChunk(const ChunkCoord& coord);
     void addChunk(const ChunkCoord& coord);
 };
@@ -13,6 +13,7 @@
 #include "imgui_impl_opengl3.h"
 
 #include "GLSL.h"
+#include "GLState.h"
 #include "Program.h"
 #include "Shape.h"
 #include "MatrixStack.h"
@@ -28,12 +29,33 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
 #include "ChunkData.h"
 #include "ChunkMesh.h"
+#include "Horizon.h"
+#include "VisibilityWalk.h"
+#include "OcclusionQueries.h"
+#include "Frustum.h"
+#include "SoftwareOcclusion.h"
+#include "ThreadPool.h"
+#include "FrameUniforms.h"
+#include "ProgramCache.h"
+#include "AssetArchive.h"
+#include "MeshData.h"
+#include "RenderQueue.h"
+#include "Collectibles.h"
+#include "CharacterRig.h"
+#include "MobSystem.h"
+#include "VoxelCollision.h"
+#include "Navigation.h"
+#include "ShaderVariants.h"
 
 #include "Bezier.h"
 #include "Spline.h"
 #include "particleSys.h"
+#include "GpuParticles.h"
 
 using namespace std;
 using namespace glm;
@@ -49,17 +71,31 @@ public:
 
 	WindowManager * windowManager = nullptr;
 
-	// shader program for terrain
-	std::shared_ptr<Program> voxelProg;
+	// lit shader for terrain, steve and diamonds, built per feature set
+	ShaderVariants litShaders;
+	std::shared_ptr<Program> litProg;
+	std::shared_ptr<Program> litFogProg; // chunks when there is no horizon to hide their edge
+	std::shared_ptr<Program> litInstancedProg; // every diamond in one draw
+	std::shared_ptr<Program> litRiggedProg; // Steve's parts in one draw
+	std::shared_ptr<Program> litMobProg; // every mob in one draw, plain coloured
+
+	// per-frame camera and light uniform block
+	FrameUniforms frameUniforms;
+
+	// every draw of the frame is queued, sorted by state and depth, then issued at once
+	RenderQueue renderQueue;
+	int voxelMaterial, voxelFogMaterial, steveMaterial, diamondMaterial, mobMaterial, skyboxMaterial, particleMaterial, horizonMaterial;
 
 	// shader program for skybox
 	std::shared_ptr<Program> skyboxProg;
 
-	//Our shader program for textures
-	std::shared_ptr<Program> texProg;
-
 	// Particle program
 	std::shared_ptr<Program> partProg;
+	// transform feedback step of the GPU particles
+	std::shared_ptr<Program> partUpdateProg;
+
+	// far terrain program
+	std::shared_ptr<Program> horizonProg;
 
 	// images
 	shared_ptr<Texture> texture0; // texture atlas
@@ -68,6 +104,7 @@ public:
 	shared_ptr<Texture> diamond_texture; // diamond texture
 
 	std::vector<std::shared_ptr<Shape>> meshes;
+	bool quantizeMeshes = false; // upload half-float / 10:10:10:2 vertices
 
 	double theta = - M_PI / 2;
 	double phi = 0.0;
@@ -83,12 +120,17 @@ public:
 	float gX = 0;
 	float gZ = 0;
 	float speed = 20.0f;
+	const float CAMERA_RADIUS = 0.25f;
 	std::unordered_map<int, bool> pressedKeys;
 
 	// tour variables
 	Spline splinepath[2];
 	bool tour = false;
 
+	// Steve: meshes 3-8 merged into one rig, joints in this order
+	enum SteveJoint { STEVE_TORSO, STEVE_HEAD, STEVE_RIGHT_ARM, STEVE_LEFT_ARM, STEVE_RIGHT_LEG, STEVE_LEFT_LEG, STEVE_JOINTS };
+	CharacterRig steveRig;
+
 	// Steve position
 	vec3 stevePosition = vec3(0,0,0);
 	float steveRotation = 0;
@@ -102,19 +144,63 @@ public:
 
 	// randomly generated terrain data
 	static const int GRID_SIZE = 3; 
+	int viewRadius = GRID_SIZE; // in chunks
+
+	// chunk level of detail, switching to the next level past each distance (in blocks)
+	bool useLOD = true;
+	float lodDistances[LOD_LEVELS - 1] = {64.0f, 128.0f, 256.0f};
+	int chunkDrawCalls = 0;
+
+	// skip sections the camera cannot see into through connected air
+	VisibilityWalk visibilityWalk;
+	bool occlusionCulling = true;
+	int culledSections = 0;
+	int frustumCulledSections = 0;
+
+	// GPU occlusion queries on chunk bounding boxes, cycled with 'c'
+	OcclusionQueries chunkQueries;
+
+	// CPU depth rasterizer run on a worker while the rest of the frame is drawn, toggled with 'v'
+	ThreadPool workers;
+	SoftwareOcclusion softwareOcclusion;
+	int softwareCulledChunks = 0;
+
+	// low-poly far terrain past the loaded chunks, drawn into the back of the depth range
+	Horizon horizon;
+	bool drawHorizon = true;
+	const float HORIZON_DEPTH = 0.99f;
+	const float HORIZON_FAR = 6000.0f;
 
 	// world gen
 	int seed;
 	World world;
 	unordered_map<ChunkCoord, ChunkMesh*> chunkMeshes;
-	vector<vec3> diamondPositions;
+	Collectibles diamonds;
 	int diamondsCollected = 0;
 
+	// wandering creepers, simulated on the workers and drawn instanced
+	MobSystem mobs;
+	mat4 mobModel; // creeper mesh standing on y = 0, about 1.7 blocks tall
+	static const int MOB_COUNT = 200;
+
+	// walkable surfaces of the loaded chunks; mobs near steve are sent paths to him
+	Navigation navigation{world};
+	vector<pair<size_t, future<Navigation::Path>>> pendingRoutes;
+	float followTimer = 0.0f;
+	const float FOLLOW_INTERVAL = 2.0f; // seconds between rounds of path requests
+	const float FOLLOW_RADIUS = 40.0f;
+	static const int MAX_FOLLOWERS = 8;
+
 	// particle variables
 	particleSys *thePartSystem;
+	GpuParticles gpuParticles;
+	bool gpuParticleSim = false; // simulate on the GPU instead, toggled with 'p'
+	int particleCount = 300;
 	float t = 0.0f;
 	float h = 0.01f;
-	bool drawParticle = false;
+	bool drawParticle = false; // the GPU fountain follows steve once a diamond is picked up
+	const float PICKUP_BURST_SECONDS = 0.5f;
+	const float PICKUP_BURST_RATE = 600.0f; // particles per second
 
 	void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 	{
@@ -147,6 +233,24 @@ public:
 		if (key == GLFW_KEY_Z && action == GLFW_RELEASE) {
 			glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 		}
+		if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+			useLOD = !useLOD;
+		}
+		if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+			gpuParticleSim = !gpuParticleSim;
+		}
+		if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+			occlusionCulling = !occlusionCulling;
+		}
+		if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+			softwareOcclusion.enabled = !softwareOcclusion.enabled;
+		}
+		if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+			chunkQueries.mode = OcclusionQueries::Mode((chunkQueries.mode + 1) % OcclusionQueries::MODE_COUNT);
+		}
+		if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+			drawHorizon = !drawHorizon;
+		}
 
 		// steve movment
 		if (key == GLFW_KEY_RIGHT && action == GLFW_PRESS){
@@ -196,113 +300,92 @@ public:
 
 	void updateMovement(float deltaTime) {
 		float moveSpeed = speed * deltaTime; // Scale speed by frame time
+		vec3 delta(0.0f);
 	
 		if (pressedKeys[GLFW_KEY_W]) {
-			eye += forward * moveSpeed;
+			delta += forward * moveSpeed;
 		}
 		if (pressedKeys[GLFW_KEY_A]) {
-			eye -= right * moveSpeed;
+			delta -= right * moveSpeed;
 		}
 		if (pressedKeys[GLFW_KEY_S]) {
-			eye -= forward * moveSpeed;
+			delta -= forward * moveSpeed;
 		}
 		if (pressedKeys[GLFW_KEY_D]) {
-			eye += right * moveSpeed;
+			delta += right * moveSpeed;
 		}
+
+		// the camera is a small box that slides along terrain instead of passing through it
+		AABB box = {eye - vec3(CAMERA_RADIUS), eye + vec3(CAMERA_RADIUS)};
+		eye += VoxelCollider(world).sweep(box, delta);
 	}
 
 	void init(const std::string& resourceDirectory)
 	{
 		GLSL::checkVersion();
+		GLState::invalidate();
 
 		// Set background color.
 		glClearColor(.12f, .34f, .56f, 1.0f);
 		// Enable z-buffer test.
-		glEnable(GL_DEPTH_TEST);
-
-		// voxel shaders
-		voxelProg = make_shared<Program>();
-		voxelProg->setVerbose(true);
-		voxelProg->setShaderNames(resourceDirectory + "/voxel_vert.glsl", resourceDirectory + "/voxel_frag.glsl");
-		voxelProg->init();
-		voxelProg->addUniform("P");
-		voxelProg->addUniform("V");
-		voxelProg->addUniform("M");
-		voxelProg->addUniform("flip");
-		voxelProg->addUniform("Texture0");
-		voxelProg->addUniform("MatShine");
-		voxelProg->addUniform("lightPos");
-		voxelProg->addAttribute("vertPos");
-		voxelProg->addAttribute("vertNor");
-		voxelProg->addAttribute("vertTex");
-
-		// Initialize the GLSL program that we will use for texture mapping
-		texProg = make_shared<Program>();
-		texProg->setVerbose(true);
-		texProg->setShaderNames(resourceDirectory + "/tex_vert.glsl", resourceDirectory + "/tex_frag.glsl");
-		texProg->init();
-		texProg->addUniform("P");
-		texProg->addUniform("V");
-		texProg->addUniform("M");
-		texProg->addUniform("flip");
-		texProg->addUniform("Texture0");
-		texProg->addUniform("MatShine");
-		texProg->addUniform("lightPos");
-		texProg->addAttribute("vertPos");
-		texProg->addAttribute("vertNor");
-		texProg->addAttribute("vertTex");
-
-		//read in a load the textures
-		// grass texture
-		texture0 = make_shared<Texture>();
-  		texture0->setFilename(resourceDirectory + "/texture_atlas.jpg");
-  		texture0->init();
-  		texture0->setUnit(0);
-  		texture0->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-		// change filtering to nearest
-		glBindTexture(GL_TEXTURE_2D, texture0->getID());
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::setEnabled(GL_DEPTH_TEST, true);
+
+		// camera and light shared by all shaders
+		frameUniforms.init();
 
+		// images decode on the workers while the shaders compile
+		texture0 = make_shared<Texture>();
+		texture0->setFilename(resourceDirectory + "/texture_atlas.jpg");
 		steve_texture = make_shared<Texture>();
 		steve_texture->setFilename(resourceDirectory + "/steve_texture.jpg");
-		steve_texture->init();
-		steve_texture->setUnit(1);
-		steve_texture->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-
 		diamond_texture = make_shared<Texture>();
 		diamond_texture->setFilename(resourceDirectory + "/diamond.png");
-		diamond_texture->init();
-		diamond_texture->setUnit(2);
-		diamond_texture->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+		skyboxTexture = make_shared<Texture>();
+		skyboxTexture->setCubeMapFaces({
+			resourceDirectory + "/skybox/Daylight Box_Right.bmp",
+			resourceDirectory + "/skybox/Daylight Box_Left.bmp",
+			resourceDirectory + "/skybox/Daylight Box_Top.bmp",
+			resourceDirectory + "/skybox/Daylight Box_Bottom.bmp",
+			resourceDirectory + "/skybox/Daylight Box_Front.bmp",
+			resourceDirectory + "/skybox/Daylight Box_Back.bmp"
+		});
+		for (auto texture : {texture0, steve_texture, diamond_texture, skyboxTexture}) {
+			texture->startDecode(workers);
+		}
 
-		splinepath[0] = Spline(glm::vec3(-24,5,10), glm::vec3(-22,0,10), glm::vec3(-22,-5, 0), 5);
-        splinepath[1] = Spline(glm::vec3(-22,-5, 0), glm::vec3(-22,-5, 0), glm::vec3(-24,-5, -10), 5);
+		// every shader below is built here; startup reports how long that took
+		ProgramCache::init("shader_cache");
+		auto shaderStart = chrono::high_resolution_clock::now();
+
+		// textured and fogged variants of the lit shader
+		litShaders.setShaderNames(resourceDirectory + "/lit_vert.glsl", resourceDirectory + "/lit_frag.glsl");
+		litShaders.setSetup([this](Program &prog, unsigned features) {
+			frameUniforms.attach(prog);
+			prog.addUniform("M");
+			prog.addUniform("MatShine");
+			prog.addUniform(features & SHADER_TEXTURED ? "Texture0" : "MatColor");
+			if (features & SHADER_FOG) prog.addUniform("fogRange");
+			prog.addAttribute("vertPos");
+			prog.addAttribute("vertNor");
+			prog.addAttribute("vertTex");
+		});
+		litProg = litShaders.get(SHADER_TEXTURED);
+		litFogProg = litShaders.get(SHADER_TEXTURED | SHADER_FOG);
+		litInstancedProg = litShaders.get(SHADER_TEXTURED | SHADER_INSTANCED | SHADER_SPIN);
+		litRiggedProg = litShaders.get(SHADER_TEXTURED | SHADER_RIGGED);
+		litMobProg = litShaders.get(SHADER_INSTANCED);
+		litMobProg->bind();
+		glUniform3f(litMobProg->getUniform("MatColor"), 0.35f, 0.75f, 0.3f);
 
 		skyboxProg = make_shared<Program>();
 		skyboxProg->setVerbose(true);
 		skyboxProg->setShaderNames(resourceDirectory + "/skybox_vert.glsl", resourceDirectory + "/skybox_frag.glsl");
 		skyboxProg->init();
-		skyboxProg->addUniform("P");
-		skyboxProg->addUniform("V");
+		frameUniforms.attach(*skyboxProg);
 		skyboxProg->addUniform("M");
 		skyboxProg->addUniform("skybox");
 		skyboxProg->addAttribute("vertPos");
 		skyboxProg->addAttribute("vertNor");
-		
-		// Load cubemap
-		vector<string> cubemapFaces = {
-			resourceDirectory + "/skybox/Daylight Box_Right.bmp",
-			resourceDirectory + "/skybox/Daylight Box_Left.bmp",
-			resourceDirectory + "/skybox/Daylight Box_Top.bmp",
-			resourceDirectory + "/skybox/Daylight Box_Bottom.bmp",
-			resourceDirectory + "/skybox/Daylight Box_Front.bmp",
-			resourceDirectory + "/skybox/Daylight Box_Back.bmp"
-		};
-		skyboxTexture = make_shared<Texture>();
-		skyboxTexture->loadCubeMap(cubemapFaces);
-		skyboxTexture->setUnit(0);
 
 		// particle program
 		partProg = make_shared<Program>();
@@ -311,15 +394,106 @@ public:
 			resourceDirectory + "/particle_vert.glsl",
 			resourceDirectory + "/particle_frag.glsl");
 		partProg->init();
-		partProg->addUniform("P");
+		frameUniforms.attach(*partProg);
 		partProg->addUniform("M");
-		partProg->addUniform("V");
-		partProg->addUniform("pColor");
 		partProg->addUniform("alphaTexture");
 		partProg->addAttribute("vertPos");
 
-		thePartSystem = new particleSys(vec3(0, 0, 0));
+		// GPU particle step: the update shader's outputs are captured, nothing is drawn
+		partUpdateProg = make_shared<Program>();
+		partUpdateProg->setVerbose(true);
+		partUpdateProg->setShaderNames(
+			resourceDirectory + "/particle_update_vert.glsl",
+			resourceDirectory + "/particle_update_frag.glsl");
+		partUpdateProg->setTransformFeedbackVaryings(GpuParticles::feedbackVaryings());
+		partUpdateProg->init();
+
+		// far terrain
+		horizonProg = make_shared<Program>();
+		horizonProg->setVerbose(true);
+		horizonProg->setShaderNames(resourceDirectory + "/horizon_vert.glsl", resourceDirectory + "/horizon_frag.glsl");
+		horizonProg->init();
+		frameUniforms.attach(*horizonProg);
+		horizonProg->addUniform("farP");
+		horizonProg->addUniform("heightMap");
+		horizonProg->addUniform("colorMap");
+		horizonProg->addUniform("tileOrigin");
+		horizonProg->addUniform("tileSize");
+		horizonProg->addUniform("texels");
+		horizonProg->addUniform("mipLevel");
+		horizonProg->addUniform("lightDir");
+		horizonProg->addUniform("loadedBounds");
+
+		glFinish(); // drivers may finish compiling lazily
+		double shaderMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - shaderStart).count();
+		printf("Shader setup: %.1f ms (program binary cache %s: %d hits, %d misses)\n", shaderMs,
+			ProgramCache::isEnabled() ? "on" : "off", ProgramCache::stats().hits, ProgramCache::stats().misses);
+
+		// upload the textures; only waiting on decodes still running and glTexImage2D happen here
+		auto textureStart = chrono::high_resolution_clock::now();
+		// grass texture
+  		texture0->init();
+  		texture0->setUnit(0);
+  		texture0->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+		// change filtering to nearest
+		GLState::bindTexture(0, GL_TEXTURE_2D, texture0->getID());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+		steve_texture->init();
+		steve_texture->setUnit(1);
+		steve_texture->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+		diamond_texture->init();
+		diamond_texture->setUnit(2);
+		diamond_texture->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+		splinepath[0] = Spline(glm::vec3(-24,5,10), glm::vec3(-22,0,10), glm::vec3(-22,-5, 0), 5);
+        splinepath[1] = Spline(glm::vec3(-22,-5, 0), glm::vec3(-22,-5, 0), glm::vec3(-24,-5, -10), 5);
+
+		// Load cubemap
+		skyboxTexture->init();
+		skyboxTexture->setUnit(0);
+		printf("Texture upload: %.1f ms on the GL thread\n",
+			chrono::duration<double, milli>(chrono::high_resolution_clock::now() - textureStart).count());
+
+		thePartSystem = new particleSys(particleCount);
 		thePartSystem->gpuSetup();
+		gpuParticles.init(partUpdateProg, particleCount);
+
+		horizon.init(World::seed);
+
+		chunkQueries.init();
+
+		voxelMaterial = addMaterial(litProg, texture0, UNIFORM_TEXTURE0, 27.9f);
+		voxelFogMaterial = addMaterial(litFogProg, texture0, UNIFORM_TEXTURE0, 27.9f);
+		steveMaterial = addMaterial(litRiggedProg, steve_texture, UNIFORM_TEXTURE0, 0.0f);
+		diamondMaterial = addMaterial(litInstancedProg, diamond_texture, UNIFORM_TEXTURE0, 0.0f);
+		mobMaterial = addMaterial(litMobProg, nullptr, UNIFORM_TEXTURE0, 8.0f);
+		skyboxMaterial = addMaterial(skyboxProg, skyboxTexture, UNIFORM_SKYBOX, 0.0f);
+		particleMaterial = addMaterial(partProg, texture0, UNIFORM_ALPHA_TEXTURE, 0.0f);
+		horizonMaterial = addMaterial(horizonProg, nullptr, UNIFORM_TEXTURE0, 0.0f);
+
+		// far terrain sits in the back sliver of the depth range, the skybox behind everything
+		RenderQueue::PassState horizonPass;
+		horizonPass.cullFace = false;
+		horizonPass.depthNear = HORIZON_DEPTH;
+		renderQueue.setPassState(RenderQueue::PASS_HORIZON, horizonPass);
+		RenderQueue::PassState skyPass;
+		skyPass.depthWrite = false;
+		skyPass.depthFunc = GL_LEQUAL;
+		skyPass.cullFace = false;
+		renderQueue.setPassState(RenderQueue::PASS_SKY, skyPass);
+	}
+
+	int addMaterial(shared_ptr<Program> prog, shared_ptr<Texture> texture, UniformSlot sampler, float shine) {
+		RenderQueue::Material material;
+		material.program = prog;
+		material.texture = texture;
+		material.sampler = sampler;
+		material.shine = shine;
+		return renderQueue.addMaterial(material);
 	}
 
 	void initImGui(GLFWwindow* window) {
@@ -337,6 +511,23 @@ public:
 	
 		int count = 0;
 		for (const auto& file : objFiles) {
+			// Meshes packed into the archive are already parsed and interleaved; the shapes
+			// upload straight from the mapped file
+			AssetArchive::Blob blob;
+			std::vector<MeshView> views;
+			if (AssetArchive::find(resourceDirectory + "/" + file, AssetArchive::ASSET_MESHES, blob) &&
+				unpackMeshes(blob.data, blob.size, views)) {
+				for (const MeshView& view : views) {
+					count += 1;
+					shared_ptr<Shape> shape = std::make_shared<Shape>(true);
+					shape->createShape(view);
+					shape->setQuantized(quantizeMeshes);
+					shape->init();
+					meshes.push_back(shape);
+				}
+				continue;
+			}
+
 			std::vector<tinyobj::shape_t> TOshapes;
 			std::vector<tinyobj::material_t> objMaterials;
 			std::string errStr;
@@ -358,6 +549,7 @@ public:
 				tinyobj::shape_t mutableShape = toShape; 
 				shape->createShape(mutableShape);
 				shape->measure();  // Computes min and max per shape
+				shape->setQuantized(quantizeMeshes);
 				shape->init();
 	
 				meshes.push_back(shape);
@@ -408,6 +600,19 @@ public:
 			normalizeMesh(meshes[i], vec3(minX, minY, minZ), vec3(maxX, maxY, maxZ));
 		}
 
+		// torso first so every limb's parent comes before it
+		vec3 shoulderOffset = vec3(0.0f, 0.3f, 0.0f);
+		std::vector<CharacterRig::Joint> steveJoints(STEVE_JOINTS);
+		steveJoints[STEVE_TORSO] = {-1, vec3(0), vec3(0, 0, 1)};
+		steveJoints[STEVE_HEAD] = {STEVE_TORSO, vec3(0), vec3(0, 1, 0)};
+		steveJoints[STEVE_RIGHT_ARM] = {STEVE_TORSO, shoulderOffset, vec3(0, 0, 1)};
+		steveJoints[STEVE_LEFT_ARM] = {STEVE_TORSO, shoulderOffset, vec3(0, 0, 1)};
+		steveJoints[STEVE_RIGHT_LEG] = {STEVE_TORSO, vec3(0), vec3(0, 0, 1)};
+		steveJoints[STEVE_LEFT_LEG] = {STEVE_TORSO, vec3(0), vec3(0, 0, 1)};
+		// the parts share one normalizing transform, which becomes the rig's bind pose
+		steveRig.init({meshes[8], meshes[6], meshes[7], meshes[5], meshes[3], meshes[4]}, steveJoints,
+			meshes[8]->getModelMatrix());
+
 		// creeper 9
 		normalizeMesh(meshes[9], meshes[9]->min, meshes[9]->max);
 
@@ -417,13 +622,19 @@ public:
 		// diamond 11
 		normalizeMesh(meshes[11], meshes[11]->min, meshes[11]->max);
 
-		initChunkData();
-		generateTrees();
-		initChunkMeshes();
+		world.onBlockChanged = [this](int x, int y, int z) { navigation.blockChanged(x, y, z); };
+		loadChunks(GRID_SIZE);
+		diamonds.init(*meshes[11]);
 		spawnDiamonds();
 
+		vec3 creeperMin = vec3(meshes[9]->getModelMatrix() * vec4(meshes[9]->min, 1.0f));
+		mobModel = scale(mat4(1.0f), vec3(0.85f)) * translate(mat4(1.0f), vec3(0, -creeperMin.y, 0)) * meshes[9]->getModelMatrix();
+		mobs.init(*meshes[9]);
+		spawnMobs(MOB_COUNT, GRID_SIZE * CHUNK_SIZE);
+
 		// set camera and steve at correct position
 		initCameraAndSteve();
+		horizon.update(eye, -1);
 
 		std::cout << "Total shapes loaded: " << count << std::endl;
 	}
@@ -437,23 +648,31 @@ public:
 		stevePosition = chunk->origin + vec3(0.5,2,0.5);
 	}
 
-	void initChunkData() {
-		for (int x = -GRID_SIZE; x < GRID_SIZE; x++) {
-			for (int z = -GRID_SIZE; z < GRID_SIZE; z++) {
+	// Load, decorate and mesh every chunk in the square of the given radius that is not loaded yet
+	void loadChunks(int radius) {
+		vector<ChunkCoord> added;
+		for (int x = -radius; x < radius; x++) {
+			for (int z = -radius; z < radius; z++) {
 				ChunkCoord pos = {x, z};
-				world.addChunk(pos); // Store chunk data
+				if (world.getChunk(pos) == nullptr) {
+					world.addChunk(pos); // Store chunk data
+					added.push_back(pos);
+				}
 			}
 		}
-	}
-
-	void generateTrees(){
-		for (int x = -GRID_SIZE; x < GRID_SIZE; x++) {
-			for (int z = -GRID_SIZE; z < GRID_SIZE; z++) {
-				ChunkCoord pos = {x, z};
-				world.getChunk(pos)->generateTrees();
-			}
+		// trees spill into neighbours, so only place them once every new chunk exists
+		for (const ChunkCoord& pos : added) {
+			world.getChunk(pos)->generateTrees();
+		}
+		for (const ChunkCoord& pos : added) {
+			chunkMeshes[pos] = new ChunkMesh(*world.getChunk(pos)); // Store chunk mesh
+			chunkMeshes[pos]->generateMesh(); // Generate mesh
+		}
+		for (const ChunkCoord& pos : added) {
+			navigation.addChunk(pos);
 		}
 	}
+
 	void spawnDiamonds(){
 		for (int x = -GRID_SIZE; x < GRID_SIZE; x++) {
 			for (int z = -GRID_SIZE; z < GRID_SIZE; z++) {
@@ -461,60 +680,82 @@ public:
 					continue;
 				}
 				ChunkCoord pos = {x, z};
-				diamondPositions.push_back(world.getChunk(pos)->origin + vec3(pos.x * 16 + 0.5, 1.5, pos.z * 16 + 0.5));
+				diamonds.add(world.getChunk(pos)->origin + vec3(pos.x * 16 + 0.5, 1.5, pos.z * 16 + 0.5));
 			}
 		}
 	}
 
-	void drawDiamonds(shared_ptr<Program> prog, float deltaTime){
-		static float totalAngle = 0.0f; // accumulated rotation
-		static float time = 0.0f;  // elapsed time
-	
-		totalAngle += glm::radians(45.0f) * deltaTime;  
-		time += deltaTime; 
-	
-		for (glm::vec3& pos : diamondPositions) {
-			float floatHeight = 0.2f * sin(time * 2.0f);  
-			glm::vec3 floatPos = pos + glm::vec3(0.0f, floatHeight, 0.0f);  // vertical offset
-	
-			mat4 Trans = glm::translate(glm::mat4(1.0f), floatPos);
-			mat4 RotY = glm::rotate(glm::mat4(1.0f), totalAngle, vec3(0, 1, 0));
-			mat4 ScaleS = glm::scale(glm::mat4(1.0f), vec3(0.3, 0.3, 0.3));
-			mat4 normTransform = meshes[11]->getModelMatrix();
-	
-			mat4 ctm = Trans * RotY * ScaleS * normTransform;
-			glUniformMatrix4fv(prog->getUniform("M"), 1, GL_FALSE, value_ptr(ctm));
-			meshes[11]->draw(prog); 
-			checkDiamondCollisions(ctm, pos);
+	// Scatter mobs over the loaded square of half-width extent blocks around the origin
+	void spawnMobs(int count, int extent) {
+		std::mt19937 random(World::seed + 1);
+		std::uniform_real_distribution<float> coord(-(float)extent, (float)extent);
+		for (int i = 0; i < count; i++) {
+			mobs.spawn(world, coord(random), coord(random), random());
+		}
+	}
+
+	// Every few seconds the mobs nearest steve ask for a path to him. Searches run on the
+	// workers; finished ones are handed to their mob on a later frame.
+	void updateFollowers(float frametime) {
+		navigation.update();
+		for (size_t i = 0; i < pendingRoutes.size();) {
+			if (pendingRoutes[i].second.wait_for(chrono::seconds(0)) != future_status::ready) {
+				i++;
+				continue;
+			}
+			mobs.setRoute(pendingRoutes[i].first, pendingRoutes[i].second.get());
+			pendingRoutes[i] = std::move(pendingRoutes.back());
+			pendingRoutes.pop_back();
+		}
+
+		followTimer -= frametime;
+		if (followTimer > 0.0f || !pendingRoutes.empty()) return;
+		followTimer = FOLLOW_INTERVAL;
+		vector<pair<float, size_t>> nearest;
+		for (size_t i = 0; i < mobs.size(); i++) {
+			float d = glm::distance(mobs.getPosition(i), stevePosition);
+			if (d < FOLLOW_RADIUS) nearest.push_back(make_pair(d, i));
+		}
+		size_t followers = std::min<size_t>(nearest.size(), MAX_FOLLOWERS);
+		partial_sort(nearest.begin(), nearest.begin() + followers, nearest.end());
+		// steve's position is his centre, a block above his feet
+		vec3 goal = stevePosition - vec3(0, 1, 0);
+		for (size_t i = 0; i < followers; i++) {
+			size_t mob = nearest[i].second;
+			pendingRoutes.push_back(make_pair(mob, navigation.requestPath(workers, mobs.getPosition(mob), goal)));
 		}
 	}
+
+	// The spin and bob are applied per instance in the vertex shader from the frame time
+	void queueDiamonds(){
+		mat4 ScaleS = glm::scale(glm::mat4(1.0f), vec3(0.3, 0.3, 0.3));
+		mat4 normTransform = meshes[11]->getModelMatrix();
+		mat4 shared = ScaleS * normTransform;
+		diamonds.submit(renderQueue, diamondMaterial, shared);
+		checkDiamondCollisions(shared);
+	}
 	
-	void checkDiamondCollisions(mat4 ctm, vec3 pos){
-		vec3 diamondBoundingSphereCenter = vec3(ctm * vec4(meshes[11]->boundingSphere.center, 1.0f));
+	void checkDiamondCollisions(const mat4& shared){
+		// diamonds are indexed by their base position, so move the probe by the current bob
+		// and by the offset of the bounding sphere from the mesh origin
+		float floatHeight = 0.2f * sin((float)glfwGetTime() * 2.0f);
+		vec3 diamondCenterOffset = vec3(shared * vec4(meshes[11]->boundingSphere.center, 1.0f)) + vec3(0.0f, floatHeight, 0.0f);
 		float diamondBoundingSphereRadius = 0.3 * meshes[11]->getModelMatrix()[0][0] * meshes[11]->boundingSphere.radius;
 
 		vec3 steveBoundingSphereCenter = stevePosition;// + meshes[8]->boundingSphere.center;
 		float steveBoundingSphereRadius = meshes[8]->getModelMatrix()[0][0] * meshes[8]->boundingSphere.radius;
 
-		float distance = glm::distance(diamondBoundingSphereCenter, steveBoundingSphereCenter);
-		float radiusSum = diamondBoundingSphereRadius + steveBoundingSphereRadius;
-
-		if(distance <= radiusSum){
-			diamondPositions.erase(std::remove(diamondPositions.begin(), diamondPositions.end(), pos), diamondPositions.end());	
-			diamondsCollected++;
-			// draw particles
-			thePartSystem->reSet();
-			drawParticle = true;
-		}
-	}
-
-	void initChunkMeshes(){
-		for (int x = -GRID_SIZE; x < GRID_SIZE; x++) {
-			for (int z = -GRID_SIZE; z < GRID_SIZE; z++) {
-				ChunkCoord pos = {x, z};
-				chunkMeshes[pos] = new ChunkMesh(*world.getChunk(pos)); // Store chunk mesh
-				chunkMeshes[pos]->generateMesh(); // Generate mesh
+		std::vector<vec3> collected;
+		int count = diamonds.collect(steveBoundingSphereCenter - diamondCenterOffset,
+			diamondBoundingSphereRadius + steveBoundingSphereRadius, collected);
+		if(count > 0){
+			diamondsCollected += count;
+			// a short burst where each diamond was; they all share one particle store and draw
+			for (const vec3& diamond : collected) {
+				thePartSystem->addEmitter(diamond + diamondCenterOffset, PICKUP_BURST_SECONDS, PICKUP_BURST_RATE);
 			}
+			// the GPU fountain keeps running once started; pickups never restart its simulation
+			drawParticle = true;
 		}
 	}
 
@@ -533,16 +774,224 @@ public:
 
 	}
 	
-	// Render the chunks
-	void renderChunks() {
+	// Pick a detail level from the horizontal distance between the camera and the chunk centre
+	int chunkLOD(ChunkMesh* mesh) {
+		if (!useLOD) return 0;
+		vec2 center = mesh->chunkData.getChunkCoords() + vec2(CHUNK_SIZE * 0.5f);
+		float dist = distance(center, vec2(eye.x, eye.z));
+		int lod = 0;
+		while (lod < LOD_LEVELS - 1 && dist > lodDistances[lod]) {
+			lod++;
+		}
+		return lod;
+	}
+
+	float farPlane() {
+		return glm::max(150.0f, viewRadius * CHUNK_SIZE * 1.5f);
+	}
+
+	// Far terrain gets its own projection and the back sliver of the depth range, so it
+	// always sits behind the real chunks but still in front of the skybox. Its pass runs
+	// after the opaque one, so chunks in front reject most of its fragments.
+	void queueHorizon(float aspect) {
+		horizon.update(eye);
+
+		renderQueue.submitCallback(RenderQueue::PASS_HORIZON, horizonMaterial, eye, [this, aspect]() {
+			mat4 P = glm::perspective(glm::radians(45.0f), aspect, 2.0f, HORIZON_FAR);
+			glUniformMatrix4fv(horizonProg->getUniform(UNIFORM_FAR_P), 1, GL_FALSE, value_ptr(P));
+			glUniform3f(horizonProg->getUniform(UNIFORM_LIGHT_DIR), 0.3f, 1.0f, 0.2f);
+			float edge = viewRadius * CHUNK_SIZE;
+			glUniform4f(horizonProg->getUniform(UNIFORM_LOADED_BOUNDS), -edge, -edge, edge, edge);
+			horizon.draw(horizonProg, eye);
+		});
+	}
+
+	// remesh sections dirtied by block edits, before any culling pass reads them
+	void updateChunkMeshes() {
+		for (const auto& pair : chunkMeshes) {
+			pair.second->update();
+		}
+	}
+
+	// Cull the chunks and queue the sections that survive
+	void queueChunks(const mat4& P) {
+		chunkDrawCalls = 0;
+		culledSections = 0;
+		frustumCulledSections = 0;
+		softwareCulledChunks = 0;
+		bool softwareTested = softwareOcclusion.finish();
+		bool walked = occlusionCulling && visibilityWalk.run(chunkMeshes, eye);
+		bool useQueries = chunkQueries.mode != OcclusionQueries::OFF;
+		if (useQueries) chunkQueries.collectResults();
+		Frustum frustum(P * View);
+
 		for (const auto& pair : chunkMeshes) {
-			ChunkCoord chunkCoords = pair.first;
 			ChunkMesh* mesh = pair.second;
-			mat4 Model = glm::translate(mat4(1.0f), vec3(mesh->chunkData.getChunkCoords().x, 0, mesh->chunkData.getChunkCoords().y)); // Offset by chunk size
-			glUniformMatrix4fv(voxelProg->getUniform("M"), 1, GL_FALSE, value_ptr(Model));
-			
-			mesh->render();
+			if (softwareTested && softwareOcclusion.isHidden(pair.first)) {
+				softwareCulledChunks++;
+				continue;
+			}
+			int lod = chunkLOD(mesh);
+			SectionMask inFrustum = mesh->sectionsInFrustum(frustum);
+			SectionMask visible = inFrustum;
+			if (walked) visible &= visibilityWalk.visibleSections(pair.first);
+
+			vec3 boxMin, boxMax;
+			bool drawChunk = visible.any();
+			GLuint condition = 0;
+			if (useQueries && drawChunk && mesh->sectionBounds(visible, boxMin, boxMax)) {
+				drawChunk = chunkQueries.testChunk(pair.first, boxMin, boxMax, eye, condition);
+			} else if (useQueries) {
+				chunkQueries.forget(pair.first);
+			}
+
+			if (drawChunk) {
+				mat4 Model = glm::translate(mat4(1.0f), vec3(mesh->chunkData.getChunkCoords().x, 0, mesh->chunkData.getChunkCoords().y)); // Offset by chunk size
+				uint32_t model = renderQueue.addModel(Model);
+				chunkDrawCalls += mesh->submit(renderQueue, drawHorizon ? voxelMaterial : voxelFogMaterial, model, lod, visible, condition);
+			} else {
+				visible.reset();
+			}
+
+			SectionMask drawable = mesh->drawableSections(lod);
+			frustumCulledSections += (drawable & ~inFrustum).count();
+			culledSections += (drawable & inFrustum & ~visible).count();
+		}
+	}
+
+	// Frame-time benchmark: grow the world and time frames with chunk LOD off and on
+	void runLODBenchmark() {
+		const int radii[] = {8, 16, 24};
+		const int frames = 60;
+
+		for (int radius : radii) {
+			loadChunks(radius);
+			viewRadius = radius;
+			eye = vec3(0, 90, 0);
+			lookAt = vec3(1, -0.25, 1);
+
+			for (int pass = 0; pass < 2; pass++) {
+				useLOD = pass == 1;
+				// one untimed frame so lazily built LOD meshes are not counted
+				render(0.0f);
+				glFinish();
+
+				auto start = chrono::high_resolution_clock::now();
+				for (int i = 0; i < frames; i++) {
+					render(0.0f);
+					glFinish();
+				}
+				double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count() / frames;
+				printf("radius %2d (%4zu chunks) LOD %-3s %7.2f ms/frame %6d chunk draws\n",
+					radius, chunkMeshes.size(), useLOD ? "on" : "off", ms, chunkDrawCalls);
+			}
+		}
+	}
+
+	// Draw the Steve and creeper meshes many times per frame with each vertex layout.
+	// Shapes are shrunk to a point so the time is vertex work rather than fill.
+	void runMeshBenchmark(const std::string& resourceDirectory) {
+		struct Layout { const char* name; bool optimize; bool quantized; };
+		const Layout layouts[] = {
+			{"source order", false, false}, {"cache optimized", true, false}, {"optimized+quantized", true, true}};
+		const char* files[] = {"Steve.obj", "creeper.obj"};
+		const int draws = 2000;
+		const int frames = 20;
+
+		GLuint timer;
+		glGenQueries(1, &timer);
+		litProg->bind();
+		glUniformMatrix4fv(litProg->getUniform(UNIFORM_M), 1, GL_FALSE, value_ptr(scale(mat4(1.0f), vec3(1e-4f))));
+
+		for (const char* file : files) {
+			std::vector<tinyobj::shape_t> TOshapes;
+			std::vector<tinyobj::material_t> objMaterials;
+			std::string errStr;
+			if (!tinyobj::LoadObj(TOshapes, objMaterials, errStr, (resourceDirectory + "/" + file).c_str())) {
+				std::cerr << "Error loading " << file << ": " << errStr << std::endl;
+				continue;
+			}
+
+			for (const Layout& layout : layouts) {
+				// the shapes view these meshes, so they live as long as the shapes do
+				std::vector<MeshData> meshData(TOshapes.size());
+				std::vector<shared_ptr<Shape>> shapes;
+				size_t triangles = 0, vertexBytes = 0;
+				float misses = 0.0f;
+				for (size_t s = 0; s < TOshapes.size(); s++) {
+					MeshData& data = meshData[s];
+					buildMeshData(TOshapes[s], data, layout.optimize);
+					shared_ptr<Shape> shape = std::make_shared<Shape>(true);
+					shape->createShape(viewOf(data));
+					shape->setQuantized(layout.quantized);
+					shape->init();
+					shapes.push_back(shape);
+
+					triangles += data.indices.size() / 3;
+					vertexBytes += data.vertices.size() * (layout.quantized ? sizeof(PackedVertex) : sizeof(MeshVertex));
+					misses += cacheMissRatio(data.indices.data(), data.indices.size(), data.vertices.size()) * (data.indices.size() / 3);
+				}
+
+				glFinish();
+				auto start = chrono::high_resolution_clock::now();
+				glBeginQuery(GL_TIME_ELAPSED, timer);
+				for (int f = 0; f < frames; f++) {
+					for (int i = 0; i < draws; i++) {
+						for (const shared_ptr<Shape>& shape : shapes) {
+							shape->draw(litProg);
+						}
+					}
+				}
+				glEndQuery(GL_TIME_ELAPSED);
+				glFinish();
+				double cpuMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count() / frames;
+				GLuint64 gpuNs = 0;
+				glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &gpuNs);
+
+				printf("%-12s %-20s %6zu tris %7zu vertex bytes ACMR %.2f  %7.2f ms GPU %7.2f ms CPU per %d draws\n",
+					file, layout.name, triangles, vertexBytes, misses / triangles, gpuNs / 1e6 / frames, cpuMs,
+					draws * (int)shapes.size());
+			}
+		}
+		glDeleteQueries(1, &timer);
+	}
+
+	// 10k mobs: simulation alone on one thread and on the pool, then whole frames with them drawn
+	void runMobBenchmark() {
+		const int entities = 10000;
+		const int steps = 120;
+		const int radius = 8;
+		const float dt = 1.0f / 60.0f;
+
+		loadChunks(radius);
+		viewRadius = radius;
+		for (auto& pending : pendingRoutes) pending.second.wait();
+		pendingRoutes.clear();
+		mobs.clear();
+		spawnMobs(entities, radius * CHUNK_SIZE);
+		printf("%zu mobs over %d chunks\n", mobs.size(), 4 * radius * radius);
+
+		for (int threaded = 0; threaded < 2; threaded++) {
+			double total = 0.0;
+			for (int i = 0; i < steps; i++) {
+				mobs.update(dt, world, threaded ? &workers : nullptr);
+				total += mobs.lastUpdateMs();
+			}
+			printf("update on %-8s %2d slices %7.3f ms/step  %6.1f ns/mob\n", threaded ? "workers" : "1 thread",
+				mobs.lastSlices(), total / steps, total / steps * 1e6 / mobs.size());
 		}
+
+		eye = vec3(0, 90, 0);
+		lookAt = vec3(1, -0.5, 1);
+		render(dt);
+		glFinish();
+		auto start = chrono::high_resolution_clock::now();
+		for (int i = 0; i < steps; i++) {
+			render(dt);
+			glFinish();
+		}
+		double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count() / steps;
+		printf("frame with %zu mobs drawn %7.2f ms/frame\n", mobs.size(), ms);
 	}
 
 	void renderUI()
@@ -558,112 +1007,69 @@ public:
 					ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar |
 					ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_AlwaysAutoResize);
 
-		ImGui::Text("Diamonds Collected: %d", diamondsCollected);
+		ImGui::Text("Mobs: %zu  update %.2f ms in %d slices", mobs.size(), mobs.lastUpdateMs(), mobs.lastSlices());
+		ImGui::Text("Navigation: %zu chunks, %zu portals, %d mobs following", navigation.chunkCount(),
+			navigation.portalCount(), mobs.followingCount());
+		if (gpuParticleSim) {
+			ImGui::Text("Particles: %d simulated on the GPU", gpuParticles.size());
+		} else {
+			ImGui::Text("Particles: %d from %d emitters, simulated on the CPU in %.2f ms against %d blocks", thePartSystem->size(),
+				thePartSystem->emitterCount(), thePartSystem->lastUpdateMs(), (int)thePartSystem->terrainBlocks());
+		}
+		ImGui::Text("Diamonds Collected: %d  left: %zu (one instanced draw)", diamondsCollected, diamonds.size());
+		ImGui::Text("Sections drawn: %d  culled: %d%s  outside view: %d", chunkDrawCalls, culledSections,
+			occlusionCulling ? "" : " (walk off)", frustumCulledSections);
+		ImGui::Text("Render queue: %d commands, %d material switches", renderQueue.commandCount(), renderQueue.materialSwitches());
+		ImGui::Text("GL state calls: %d issued, %d skipped", GLState::lastFrame().issued, GLState::lastFrame().skipped);
+		ImGui::Text("CPU occlusion: %s  chunks hidden: %d  %.2f ms", softwareOcclusion.enabled ? "on" : "off",
+			softwareCulledChunks, softwareOcclusion.lastMs());
+		ImGui::Text("Occlusion queries: %s  chunks hidden: %d  tested: %d",
+			OcclusionQueries::modeName(chunkQueries.mode), chunkQueries.hiddenCount(), chunkQueries.issuedCount());
 		ImGui::End();
 
 		ImGui::Render();
     	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());	
 	}
 
+	// Steve's collision box; stevePosition is one block above his feet
+	AABB steveBox(const vec3& position) const {
+		return AABB{position + vec3(-0.3f, -1.0f, -0.3f), position + vec3(0.3f, 0.8f, 0.3f)};
+	}
+
+	// Step one block: straight across, up onto a single block, or off a ledge down to the ground
 	void moveSteve(int direction){
-		if (isMoving) return;
+		static const vec3 STEPS[4] = {vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 0, -1), vec3(0, 0, 1)}; // right, left, up, down
+		static const float ROTATIONS[4] = {0.0f, 180.0f, 90.0f, 270.0f};
+		if (isMoving || direction < 0 || direction > 3) return;
 
 		isMoving = true;
-
-		int block1 = 0;
-		int block2 = 0;
-		int block3 = 0;
-		switch (direction){
-			case 0: // right
-				block1 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(1,1,0)); // block to right
-				block2 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(1,2,0)); // block above that one
-				block3 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(1,0,0)); // block below that one
-				if(block1 == 0) { // if block to the right is empty
-					if(block2 == 0 && block3 > 0){ // if block above that is empty and block below is not empty
-						targetStevePosition = stevePosition + vec3(1, 0, 0); // move right
-					} else if (block3 == 0) { // if the block below is empty
-						int counter = -1;
-						while (world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(1,counter,0)) == 0){
-							counter--;
-						}
-						targetStevePosition = stevePosition + vec3(1, counter, 0); // move right one and down as many as we need to go
-					}
-				} else if(block1 != 0 && block2 == 0){
-					targetStevePosition = stevePosition + vec3(1, 1, 0);
-				}
-				steveRotation = 0.0f;
-				return;
-			case 1: // left
-				block1 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(-1,1,0)); // block to left
-				block2 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(-1,2,0)); // block above that one
-				block3 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(-1,0,0)); // block below that one
-				if(block1 == 0) { // if block to the left is empty
-					if(block2 == 0 && block3 > 0){ // if block above that is empty and block below is not empty
-						targetStevePosition = stevePosition + vec3(-1, 0, 0); // move left
-					} else if (block3 == 0) { // if the block below is empty
-						int counter = -1;
-						while (world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(-1,counter,0)) == 0){
-							counter--;
-						}
-						targetStevePosition = stevePosition + vec3(-1, counter, 0); // move left one and down as many as we need to go
-					}
-				} else if(block1 != 0 && block2 == 0){
-					targetStevePosition = stevePosition + vec3(-1, 1, 0);
-				}
-				steveRotation = 180.0f;
-			return;
-			case 2: // up
-				block1 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,1,-1)); // block to up
-				block2 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,2,-1)); // block above that one
-				block3 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,0,-1)); // block below that one
-				if(block1 == 0) { // if block to the up is empty
-					if(block2 == 0 && block3 > 0){ // if block above that is empty and block below is not empty
-						targetStevePosition = stevePosition + vec3(0, 0, -1); // move up
-					} else if (block3 == 0) { // if the block below is empty
-						int counter = -1;
-						while (world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,counter,-1)) == 0){
-							counter--;
-						}
-						targetStevePosition = stevePosition + vec3(0, counter, -1); // move up one and down as many as we need to go
-					}
-				} else if(block1 != 0 && block2 == 0){
-					targetStevePosition = stevePosition + vec3(0, 1, -1);
-				}
-				steveRotation = 90.0f;
-			return;
-			case 3: // down
-				block1 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,1,1)); // block to down
-				block2 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,2,1)); // block above that one
-				block3 = world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,0,1)); // block below that one
-				if(block1 == 0) { // if block to the down is empty
-					if(block2 == 0 && block3 > 0){ // if block above that is empty and block below is not empty
-						targetStevePosition = stevePosition + vec3(0, 0, 1); // move right
-					} else if (block3 == 0) { // if the block below is empty
-						int counter = -1;
-						while (world.getBlock(stevePosition - vec3(0.5,2,0.5) + vec3(0,counter,1)) == 0){
-							counter--;
-						}
-						targetStevePosition = stevePosition + vec3(0, counter, 1); // move right one and down as many as we need to go
-					}
-				} else if(block1 != 0 && block2 == 0){
-					targetStevePosition = stevePosition + vec3(0, 1, 1);
-				}
-				steveRotation = 270.0f;
-				return;
-			default:
-				return;
+		steveRotation = ROTATIONS[direction];
+		targetStevePosition = stevePosition;
+
+		VoxelCollider collider(world);
+		AABB box = steveBox(stevePosition);
+		uint8_t hits;
+		vec3 moved = collider.sweep(box, STEPS[direction], &hits);
+		if (hits) {
+			// blocked, so climb if there is room one block up
+			AABB raised = box;
+			raised.min.y += 1.0f;
+			raised.max.y += 1.0f;
+			if (collider.overlaps(raised)) return;
+			moved = vec3(0, 1, 0) + collider.sweep(raised, STEPS[direction], &hits);
+			if (hits) return;
 		}
+
+		box.min += moved;
+		box.max += moved;
+		moved.y += collider.sweep(box, vec3(0, -CHUNK_HEIGHT, 0)).y;
+		targetStevePosition = stevePosition + moved;
 	}
 
 	void animateSteve(float deltaTime){
+		// standing still every joint is at rest
+		float angles[STEVE_JOINTS] = {};
 		if (isMoving) {
-			static float walkTime = 0.0f;
-			walkTime += deltaTime;
-
-			float speed = 8.0f;
-			float maxAngle = 30.0f * (M_PI / 180.0f);
-			
-			vec3 shoulderOffset = vec3(0.0f, 0.3f, 0.0f);
 			float swingAngle = 35.0f * (M_PI/180.0f); 
 
 			// Calculate animation angle
@@ -671,70 +1077,16 @@ public:
 			walkCycle += deltaTime * 8.0f; 
 			float angle = sinf(walkCycle) * swingAngle;
 
-			// right arm
-			mat4 baseModel = meshes[7]->getModelMatrix();
-			mat4 TransToShoulder = glm::translate(mat4(1.0f), shoulderOffset);
-			mat4 ArmRotation = glm::rotate(mat4(1.0f), -angle, vec3(0,0,1)); 
-			mat4 TransBack = glm::translate(mat4(1.0f), -shoulderOffset);
-			float rotX = steveRotation * (M_PI/180.0f);	
-			mat4 BodyRot = glm::rotate(mat4(1.0f), 
-							rotX, 
-							vec3(0,1,0));
-			mat4 ctm = glm::translate(mat4(1.0f), stevePosition) * 
-					BodyRot * 
-					TransToShoulder * 
-					ArmRotation * 
-					TransBack * 
-					baseModel;
-
-			glUniformMatrix4fv(texProg->getUniform("M"), 1, GL_FALSE, value_ptr(ctm));
-			meshes[7]->draw(texProg);
-
-			// left arm
-			baseModel = meshes[5]->getModelMatrix();
-			TransToShoulder = glm::translate(mat4(1.0f), shoulderOffset);
-			ArmRotation = glm::rotate(mat4(1.0f), angle, vec3(0,0,1)); 
-			TransBack = glm::translate(mat4(1.0f), -shoulderOffset);
-			rotX = steveRotation * (M_PI/180.0f);	
-			BodyRot = glm::rotate(mat4(1.0f), 
-						rotX, 
-						vec3(0,1,0));
-			ctm = glm::translate(mat4(1.0f), stevePosition) * 
-				BodyRot * 
-				TransToShoulder * 
-				ArmRotation * 
-				TransBack * 
-				baseModel;
-
-			glUniformMatrix4fv(texProg->getUniform("M"), 1, GL_FALSE, value_ptr(ctm));
-			meshes[5]->draw(texProg);
-
-	
-			// Right leg (forward)
-			setModel(texProg, meshes[3], stevePosition, steveRotation * M_PI / 180.0f, 0, angle, vec3(1,1,1));
-			meshes[3]->draw(texProg);
-	
-			// Left leg (backward)
-			setModel(texProg, meshes[4], stevePosition, steveRotation * M_PI / 180.0f, 0, -angle, vec3(1,1,1));
-			meshes[4]->draw(texProg);
-	
-			// Head (no rotation)
-			setModel(texProg, meshes[6], stevePosition, steveRotation * M_PI / 180.0f, 0, 0, vec3(1,1,1));
-			meshes[6]->draw(texProg);
-	
-			// Torso (no rotation)
-			setModel(texProg, meshes[8], stevePosition, steveRotation * M_PI / 180.0f, 0, 0, vec3(1,1,1));
-			meshes[8]->draw(texProg);
-	
-		} else {
-			setModel(texProg, meshes[3], stevePosition, steveRotation * M_PI / 180, 0, 0, vec3(1,1,1));
-			meshes[3]->draw(texProg); // right leg
-			meshes[4]->draw(texProg); // left leg
-			meshes[5]->draw(texProg); // left arm
-			meshes[6]->draw(texProg); // head
-			meshes[7]->draw(texProg); // right arm
-			meshes[8]->draw(texProg); // torso
+			// arms and legs swing against each other
+			angles[STEVE_RIGHT_ARM] = -angle;
+			angles[STEVE_LEFT_ARM] = angle;
+			angles[STEVE_RIGHT_LEG] = angle;
+			angles[STEVE_LEFT_LEG] = -angle;
 		}
+
+		mat4 root = glm::translate(mat4(1.0f), stevePosition) *
+			glm::rotate(mat4(1.0f), (float)(steveRotation * M_PI / 180.0f), vec3(0, 1, 0));
+		steveRig.submit(renderQueue, steveMaterial, root, angles);
 	}
 
 	void updateUsingCameraPath(float frametime)  {
@@ -753,8 +1105,8 @@ public:
 		}
 	}
 
-	/* helper function to set model trasnforms */
-  	void setModel(shared_ptr<Program> curS, std::shared_ptr<Shape> shape, vec3 trans, float rotY, float rotX, float rotZ, vec3 sc) {
+	/* helper function to build model trasnforms */
+  	mat4 modelMatrix(std::shared_ptr<Shape> shape, vec3 trans, float rotY, float rotX, float rotZ, vec3 sc) {
   		mat4 Trans = glm::translate( glm::mat4(1.0f), trans);
   		mat4 RotX = glm::rotate( glm::mat4(1.0f), rotX, vec3(1, 0, 0));
   		mat4 RotY = glm::rotate( glm::mat4(1.0f), rotY, vec3(0, 1, 0));
@@ -764,8 +1116,7 @@ public:
 
 		mat4 normTransform = shape->getModelMatrix();
     
-  		mat4 ctm = Trans*RotX*RotY*RotZ*ScaleS * normTransform;
-  		glUniformMatrix4fv(curS->getUniform("M"), 1, GL_FALSE, value_ptr(ctm));
+  		return Trans*RotX*RotY*RotZ*ScaleS * normTransform;
   	}
 
 	void render(float frametime) {
@@ -774,6 +1125,8 @@ public:
 		glfwGetFramebufferSize(windowManager->getHandle(), &width, &height);
 		glViewport(0, 0, width, height);
 
+		GLState::beginFrame();
+
 		// Clear framebuffer.
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -789,20 +1142,37 @@ public:
 		
 		// Apply perspective projection.
 		Projection->pushMatrix();
-		Projection->perspective(45.0f, aspect, 0.01f, 150.0f);
+		Projection->perspective(45.0f, aspect, 0.01f, farPlane());
 
 		updateMovement(frametime);
 		updateUsingCameraPath(frametime);
 
-		texProg->bind();
-		glUniformMatrix4fv(texProg->getUniform("P"), 1, GL_FALSE, value_ptr(Projection->topMatrix()));
-		glUniformMatrix4fv(texProg->getUniform("V"), 1, GL_FALSE, value_ptr(View));
-		glUniform3f(texProg->getUniform("lightPos"), 2.0+lightTrans, 60.0, 2.0);
-		glUniform1f(texProg->getUniform("MatShine"), 0.0f);
-		glUniform1i(texProg->getUniform("flip"), 1);
-		steve_texture->bind(texProg->getUniform("Texture0"));
+		// one upload of the camera and light for every shader this frame
+		frameUniforms.update(Projection->topMatrix(), View, vec3(-2.0 + lightTrans, 60.0, 2.0), (float)glfwGetTime());
+
+		// chunk occlusion is rasterized on a worker while the rest of the frame is queued
+		updateChunkMeshes();
+		if (softwareOcclusion.enabled) {
+			softwareOcclusion.start(workers, chunkMeshes, Projection->topMatrix() * View, eye);
+		}
+
+		renderQueue.begin(eye, farPlane());
+		// the world shares the front of the depth range with the horizon behind it
+		RenderQueue::PassState worldPass;
+		worldPass.depthFar = drawHorizon ? HORIZON_DEPTH : 1.0;
+		renderQueue.setPassState(RenderQueue::PASS_OPAQUE, worldPass);
+		renderQueue.setPassState(RenderQueue::PASS_TRANSPARENT, worldPass);
 
-		// update steve movement and draw him
+		if (drawHorizon) {
+			queueHorizon(aspect);
+		} else {
+			// without the horizon the chunks fade out over their last ring instead of ending in a hard edge
+			float edge = viewRadius * CHUNK_SIZE;
+			litFogProg->bind();
+			glUniform2f(litFogProg->getUniform(UNIFORM_FOG_RANGE), edge - CHUNK_SIZE * 1.5f, edge);
+		}
+
+		// update steve movement and queue him
 		if (isMoving) {
 			vec3 moveDir = targetStevePosition - stevePosition;
 			
@@ -818,67 +1188,54 @@ public:
 		
 		// Update animation
 		animateSteve(frametime);
+		queueDiamonds();
+		updateFollowers(frametime);
+		mobs.update(frametime, world, &workers);
+		mobs.submit(renderQueue, mobMaterial, mobModel);
+
+		// skybox at the very back of the depth range, behind the horizon
+		renderQueue.submit(RenderQueue::PASS_SKY, skyboxMaterial, *meshes[10], modelMatrix(meshes[10], vec3(0), 0, 0, 0, vec3(1.0f)));
+
+		if(gpuParticleSim && drawParticle){
+			vec3 source = vec3(stevePosition.x, stevePosition.y + 1, stevePosition.z);
+			renderQueue.submitCallback(RenderQueue::PASS_TRANSPARENT, particleMaterial, source, [this, source]() {
+				mat4 particlePos = translate(mat4(1.0f), source);
+				CHECKED_GL_CALL(glUniformMatrix4fv(partProg->getUniform(UNIFORM_M), 1, GL_FALSE, value_ptr(particlePos)));
+				gpuParticles.draw();
+			});
+		}
+		if(!gpuParticleSim && thePartSystem->size() > 0){
+			// pickup bursts are simulated in world space
+			renderQueue.submitCallback(RenderQueue::PASS_TRANSPARENT, particleMaterial, stevePosition, [this]() {
+				mat4 identity(1.0f);
+				CHECKED_GL_CALL(glUniformMatrix4fv(partProg->getUniform(UNIFORM_M), 1, GL_FALSE, value_ptr(identity)));
+				thePartSystem->drawMe(partProg);
+			});
+		}
 
-		glUniformMatrix4fv(texProg->getUniform("P"), 1, GL_FALSE, value_ptr(Projection->topMatrix()));
-		glUniformMatrix4fv(texProg->getUniform("V"), 1, GL_FALSE, value_ptr(View));
-		glUniform3f(texProg->getUniform("lightPos"), 2.0+lightTrans, 60.0, 2.0);
-		glUniform1f(texProg->getUniform("MatShine"), 0.0f);
-		glUniform1i(texProg->getUniform("flip"), 1);
-		diamond_texture->bind(texProg->getUniform("Texture0"));
-		drawDiamonds(texProg, frametime);
-		
-		texProg->unbind();
-
-		// draw chunks
-		voxelProg->bind();
-		glUniformMatrix4fv(voxelProg->getUniform("P"), 1, GL_FALSE, value_ptr(Projection->topMatrix()));
-		glUniformMatrix4fv(voxelProg->getUniform("V"), 1, GL_FALSE, value_ptr(View));
-		glUniform3f(voxelProg->getUniform("lightPos"), -2.0+lightTrans, 60.0, 2.0);
-		glUniform1f(voxelProg->getUniform("MatShine"), 27.9);
-		glUniform1i(voxelProg->getUniform("flip"), 0);
-		texture0->bind(voxelProg->getUniform("Texture0"));
-		renderChunks();
-		voxelProg->unbind();
-		
-		// draw skybox
-		glDepthMask(GL_FALSE);
-		glDepthFunc(GL_LEQUAL);
-		glDisable(GL_CULL_FACE);
-		skyboxProg->bind();
-		// Remove translation from the view matrix
-		mat4 view = mat4(mat3(View)); 
-		glUniformMatrix4fv(skyboxProg->getUniform("P"), 1, GL_FALSE, value_ptr(Projection->topMatrix()));
-		glUniformMatrix4fv(skyboxProg->getUniform("V"), 1, GL_FALSE, value_ptr(view));
-
-		setModel(skyboxProg, meshes[10], vec3(0), 0, 0, 0, vec3(1.0f)); // Scale up
-		meshes[10]->draw(skyboxProg);
-
-		skyboxProg->unbind();
-
-		// Restore depth settings
-		glEnable(GL_CULL_FACE);
-		glDepthMask(GL_TRUE);
-		glDepthFunc(GL_LESS);
-
-		if(drawParticle){
-			// draw particles
-			partProg->bind();
-			texture0->bind(partProg->getUniform("alphaTexture"));
-			CHECKED_GL_CALL(glUniformMatrix4fv(partProg->getUniform("P"), 1, GL_FALSE, value_ptr(Projection->topMatrix())));
-			CHECKED_GL_CALL(glUniformMatrix4fv(partProg->getUniform("V"), 1, GL_FALSE, value_ptr(View)));
-			mat4 matrix = mat4(1.0f);  
-			mat4 particlePos = translate(matrix, vec3(stevePosition.x, stevePosition.y + 1, stevePosition.z));
-			CHECKED_GL_CALL(glUniformMatrix4fv(partProg->getUniform("M"), 1, GL_FALSE, value_ptr(particlePos)));
-			
-			CHECKED_GL_CALL(glUniform3f(partProg->getUniform("pColor"), 0.9, 0.7, 0.7));
-			
-			thePartSystem->drawMe(partProg);
-			thePartSystem->update();
+		// chunks last, giving the occlusion worker as long as possible
+		queueChunks(Projection->topMatrix());
+
+		renderQueue.execute();
+
+		// test boxes against this frame's depth for the next frames to use
+		if (chunkQueries.mode != OcclusionQueries::OFF) {
+			litProg->bind();
+			chunkQueries.issueQueries(litProg->getUniform(UNIFORM_M));
+			litProg->unbind();
+		}
 
-			partProg->unbind();
-			//drawParticle = false;
+		if (gpuParticleSim) {
+			if (drawParticle) {
+				gpuParticles.update();
+			}
+		} else {
+			thePartSystem->setCamera(View);
+			thePartSystem->update(frametime, world, &workers);
 		}
 
+		GLState::depthRange(0.0, 1.0);
+
 		// Pop matrix stacks.
 		Projection->popMatrix();
 	}
@@ -889,9 +1246,49 @@ int main(int argc, char *argv[])
 	// Where the resources are loaded from
 	std::string resourceDir = "../resources";
 
-	if (argc >= 2)
+	bool benchLOD = false;
+	bool benchMeshes = false;
+	bool benchMobs = false;
+	bool quantizeMeshes = false;
+	bool useArchive = true;
+	int particleCount = 300;
+	for (int i = 1; i < argc; i++)
 	{
-		World::seed = atoi(argv[1]);
+		std::string arg = argv[i];
+		if (arg == "--bench-lod")
+		{
+			benchLOD = true;
+		}
+		else if (arg == "--bench-meshes")
+		{
+			benchMeshes = true;
+		}
+		else if (arg == "--bench-mobs")
+		{
+			benchMobs = true;
+		}
+		else if (arg == "--quantize-meshes")
+		{
+			quantizeMeshes = true;
+		}
+		else if (arg == "--no-shader-cache")
+		{
+			// compile every shader from source, to compare startup time against the cache
+			ProgramCache::setEnabled(false);
+		}
+		else if (arg == "--particles" && i + 1 < argc)
+		{
+			particleCount = atoi(argv[++i]);
+		}
+		else if (arg == "--no-archive")
+		{
+			// load the loose files, to compare startup time against the packed archive
+			useArchive = false;
+		}
+		else
+		{
+			World::seed = atoi(argv[i]);
+		}
 	}
 
 	Application *application = new Application();
@@ -903,14 +1300,44 @@ int main(int argc, char *argv[])
 	windowManager->init(640, 480);
 	windowManager->setEventCallbacks(application);
 	application->windowManager = windowManager;
+	application->quantizeMeshes = quantizeMeshes;
+	application->particleCount = particleCount;
 
 	// This is the code that will likely change program to program as you
 	// may need to initialize or set up different data and state
 
+	// Shaders, images and meshes are read from <resources>.pak when it has been packed
+	auto startupStart = chrono::high_resolution_clock::now();
+	if (useArchive && AssetArchive::mount(resourceDir + ".pak", resourceDir))
+	{
+		printf("Mounted asset archive %s.pak\n", resourceDir.c_str());
+	}
+
 	application->init(resourceDir);
 	application->initGeom(resourceDir);
+	printf("Asset startup: %.1f ms\n",
+		chrono::duration<double, std::milli>(chrono::high_resolution_clock::now() - startupStart).count());
 	application->initImGui(windowManager->getHandle());
 
+	if (benchMeshes)
+	{
+		application->runMeshBenchmark(resourceDir);
+		windowManager->shutdown();
+		return 0;
+	}
+	if (benchMobs)
+	{
+		application->runMobBenchmark();
+		windowManager->shutdown();
+		return 0;
+	}
+	if (benchLOD)
+	{
+		application->runLODBenchmark();
+		windowManager->shutdown();
+		return 0;
+	}
+
 	auto lastTime = chrono::high_resolution_clock::now();
 	// Loop until the user closes the window.
 	while (! glfwWindowShouldClose(windowManager->getHandle()))
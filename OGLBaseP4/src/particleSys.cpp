@@ -1,121 +1,473 @@
-#define GLM_ENABLE_EXPERIMENTAL
 #include <iostream>
 #include <algorithm>
-#include <glm/gtx/matrix_decompose.hpp>
-#include <glm/gtx/quaternion.hpp>
+#include <cfloat>
+#include <chrono>
+#include <future>
 #include "particleSys.h"
 #include "GLSL.h"
+#include "GLState.h"
+#include "ThreadPool.h"
+#include "World.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PARTICLE_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PARTICLE_LANES 4
+#endif
 
 using namespace std;
 
-particleSys::particleSys(vec3 source) {
+namespace {
+
+	const size_t MIN_SLICE = 16384; // particles per job; below this a thread hand-off costs more than it saves
+
+	// birth ranges, in blocks and seconds
+	const vec3 VELOCITY_MIN = vec3(-1.1f, -0.4f, -1.2f);
+	const vec3 VELOCITY_MAX = vec3(1.2f, 3.6f, 1.1f);
+	const float LIFE_MIN = 0.8f, LIFE_MAX = 1.6f;
+	const float FREE = FLT_MAX; // tEnd of a slot with no particle, so it never dies
+
+	// terrain response, in blocks and seconds
+	const float MAX_STEP = 0.05f;       // longer frames are simulated as this, so no step crosses more than a block
+	const float TERMINAL_SPEED = 20.0f; // fastest fall
+	const float RESTITUTION = 0.35f;    // share of the speed into a face kept by the bounce
+	const float SETTLE_SPEED = 1.0f;    // landings slower than this rest instead of bouncing
+	const float FRICTION = 8.0f;        // how fast a resting particle stops sliding
+	const float FACE_OFFSET = 0.001f;   // gap left between a stopped particle and the face
+	const int MAX_TERRAIN_EXTENT = 64;  // largest snapshot side, in blocks
+
+	const size_t STREAM_STRIDE = particleSys::STREAM_FLOATS * sizeof(GLfloat);
+	const GLuint64 FENCE_TIMEOUT = 1000000000; // ns; the region is rewritten after this regardless
+
+#if PARTICLE_LANES == 8
+	typedef __m256 vfloat;
+	inline vfloat vset(float f) { return _mm256_set1_ps(f); }
+	inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+	inline void vstore(float *p, vfloat v) { _mm256_storeu_ps(p, v); }
+	inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+	inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+	inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+	inline vfloat vless(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline int vlessmask(vfloat a, vfloat b) { return _mm256_movemask_ps(vless(a, b)); }
+#elif PARTICLE_LANES == 4
+	typedef __m128 vfloat;
+	inline vfloat vset(float f) { return _mm_set1_ps(f); }
+	inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+	inline void vstore(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+	inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+	inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+	inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+	inline vfloat vless(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+	inline int vlessmask(vfloat a, vfloat b) { return _mm_movemask_ps(vless(a, b)); }
+#endif
+
+	// xorshift32 scaled to [l, h]
+	float randFloat(uint32_t &state, float l, float h)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		float r = (state >> 8) * (1.0f / 16777216.0f);
+		return (1.0f - r) * l + r * h;
+	}
 
-	numP = 300;	
+	size_t sliceCount(ThreadPool *pool, size_t count)
+	{
+		return pool ? std::min<size_t>(pool->size() + 1, std::max<size_t>(1, count / MIN_SLICE)) : 1;
+	}
+
+	// Run fn(slice, begin, end) over [0, count) in slices, the calling thread taking the first
+	template <class F>
+	void forSlices(ThreadPool *pool, size_t count, F fn)
+	{
+		size_t jobs = sliceCount(pool, count);
+		size_t slice = (count + jobs - 1) / jobs;
+		vector<future<void>> pending;
+		for (size_t j = 1; j < jobs; j++)
+		{
+			size_t begin = std::min(count, j * slice), end = std::min(count, begin + slice);
+			pending.push_back(pool->submit([fn, j, begin, end]() { fn(j, begin, end); }));
+		}
+		fn(0, 0, std::min(count, slice));
+		for (future<void> &job : pending)
+		{
+			job.get();
+		}
+	}
+}
+
+particleSys::particleSys(int capacity) {
+
+	liveCount = 0;
 	t = 0.0f;
-	h = 0.01f;
-	g = vec3(0.0f, -0.098, 0.0f);
-	start = source;
+	g = vec3(0.0f, -9.8f, 0.0f);
+	liveMin = liveMax = vec3(0.0f);
 	theCamera = glm::mat4(1.0);
+	vertArrObj = 0;
+	vertBuffObj = 0;
+	gpuCapacity = 0;
+	ringRegion = 0;
+	for (GLsync &fence : ringFences) {
+		fence = 0;
+	}
+	updateMs = 0.0;
+	emitters.resize(MAX_EMITTERS);
+	emitterActive.assign(MAX_EMITTERS, 0);
+	for (int e = MAX_EMITTERS - 1; e >= 0; e--) {
+		freeEmitters.push_back(e);
+	}
+	reserve(capacity);
+}
+
+void particleSys::reserve(int count) {
+	size_t n = (size_t)std::max(count, 0), old = posX.size();
+	if (n <= old) {
+		return;
+	}
+	posX.resize(n); posY.resize(n); posZ.resize(n);
+	velX.resize(n, 0.0f); velY.resize(n, 0.0f); velZ.resize(n, 0.0f);
+	tEnd.resize(n, FREE);
+	invLife.resize(n, 0.0f);
+	alpha.resize(n, 0.0f);
+	color.resize(n);
+	seed.resize(n);
+	depth.resize(n);
+	live.reserve(n);
+	liveDepth.reserve(n);
+	order.reserve(n);
+	// lowest slots on top of the free list, so live particles stay near the front
+	for (size_t i = n; i-- > old;) {
+		seed[i] = 2654435761u * (uint32_t)(i + 1);
+		freeSlots.push_back((uint32_t)i);
+	}
 }
 
 void particleSys::gpuSetup() {
 
-  cout << "start: " << start.x << " " << start.y << " " <<start.z << endl;
-	for (int i=0; i < numP; i++) {
-		points[i*3+0] = start.x;
-		points[i*3+1] = start.y;
-		points[i*3+2] = start.z;
+	//generate the VAO
+	glGenVertexArrays(1, &vertArrObj);
+	GLState::bindVertexArray(vertArrObj);
+
+	//one interleaved stream buffer, a ring of regions; each particle is one instance of a single point
+	glGenBuffers(1, &vertBuffObj);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertBuffObj);
+	gpuCapacity = std::max<size_t>(posX.size(), 1);
+	glBufferData(GL_ARRAY_BUFFER, RING_REGIONS * gpuCapacity * STREAM_STRIDE, NULL, GL_STREAM_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STREAM_STRIDE, (const void *)0);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, STREAM_STRIDE, (const void *)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(0, 1);
+	glVertexAttribDivisor(1, 1);
+	GLState::bindVertexArray(0);
 
-		auto particle = make_shared<Particle>(start);
-		particles.push_back(particle);
-		particle->load(start);
+	assert(glGetError() == GL_NO_ERROR);
+}
+
+bool particleSys::addEmitter(const vec3 &position, float duration, float rate) {
+	if (freeEmitters.empty()) {
+		return false;
 	}
+	int e = freeEmitters.back();
+	freeEmitters.pop_back();
+	emitters[e] = Emitter{position, duration, rate, 0.0f};
+	emitterActive[e] = 1;
+	return true;
+}
 
-	//generate the VAO
-   glGenVertexArrays(1, &vertArrObj);
-   glBindVertexArray(vertArrObj);
-
-   //generate vertex buffer to hand off to OGL - using instancing
-   glGenBuffers(1, &vertBuffObj);
-   //set the current state to focus on our vertex buffer
-   glBindBuffer(GL_ARRAY_BUFFER, vertBuffObj);
-   //actually memcopy the data - only do this once
-   glBufferData(GL_ARRAY_BUFFER, sizeof(points), &points[0], GL_STREAM_DRAW);
-   
-   assert(glGetError() == GL_NO_ERROR);
-	
+void particleSys::birth(uint32_t i, const vec3 &position)
+{
+	uint32_t &state = seed[i];
+	posX[i] = position.x;
+	posY[i] = position.y;
+	posZ[i] = position.z;
+	velX[i] = randFloat(state, VELOCITY_MIN.x, VELOCITY_MAX.x);
+	velY[i] = randFloat(state, VELOCITY_MIN.y, VELOCITY_MAX.y);
+	velZ[i] = randFloat(state, VELOCITY_MIN.z, VELOCITY_MAX.z);
+	float lifespan = randFloat(state, LIFE_MIN, LIFE_MAX);
+	tEnd[i] = t + lifespan;
+	invLife[i] = 1.0f / lifespan;
+	alpha[i] = 1.0f;
+	color[i] = vec3(randFloat(state, 0.85f, 0.95f), randFloat(state, 0.6f, 0.8f), randFloat(state, 0.6f, 0.8f));
+}
+
+// Every active emitter spawns its share of this step into free slots, growing the arrays
+// only when the free list runs dry
+void particleSys::emit(float dt)
+{
+	for (int e = 0; e < MAX_EMITTERS; e++) {
+		if (!emitterActive[e]) {
+			continue;
+		}
+		Emitter &emitter = emitters[e];
+		emitter.accumulator += emitter.rate * std::min(dt, emitter.remaining);
+		for (; emitter.accumulator >= 1.0f; emitter.accumulator -= 1.0f) {
+			if (freeSlots.empty()) {
+				reserve(std::max(256, 2 * capacity()));
+			}
+			birth(freeSlots.back(), emitter.position);
+			freeSlots.pop_back();
+		}
+		emitter.remaining -= dt;
+		if (emitter.remaining <= 0.0f) {
+			emitterActive[e] = 0;
+			freeEmitters.push_back(e);
+		}
+	}
 }
 
-void particleSys::reSet() {
-	for (int i=0; i < numP; i++) {
-		particles[i]->load(start);
+void particleSys::simulate(size_t begin, size_t end, float h, const vec3 &viewZ, vector<uint32_t> &dead)
+{
+	bool ground = terrain.volume() > 0;
+	size_t i = begin;
+#ifdef PARTICLE_LANES
+	vfloat H = vset(h), T = vset(t), FREE_T = vset(FREE), FALL = vset(-TERMINAL_SPEED);
+	vfloat GX = vset(g.x * h), GY = vset(g.y * h), GZ = vset(g.z * h);
+	vfloat VX = vset(viewZ.x), VY = vset(viewZ.y), VZ = vset(viewZ.z);
+	float fromX[PARTICLE_LANES], fromY[PARTICLE_LANES], fromZ[PARTICLE_LANES];
+	for (; i + PARTICLE_LANES <= end; i += PARTICLE_LANES) {
+		vfloat death = vload(&tEnd[i]);
+		vfloat alive = vless(death, FREE_T); // free slots stay where they are
+		vfloat vx = vadd(vload(&velX[i]), vand(alive, GX));
+		vfloat vy = vmax(vadd(vload(&velY[i]), vand(alive, GY)), FALL);
+		vfloat vz = vadd(vload(&velZ[i]), vand(alive, GZ));
+		vfloat x = vload(&posX[i]), y = vload(&posY[i]), z = vload(&posZ[i]);
+		vstore(fromX, x);
+		vstore(fromY, y);
+		vstore(fromZ, z);
+		vstore(&velX[i], vx);
+		vstore(&velY[i], vy);
+		vstore(&velZ[i], vz);
+		vstore(&posX[i], vadd(x, vmul(H, vx)));
+		vstore(&posY[i], vadd(y, vmul(H, vy)));
+		vstore(&posZ[i], vadd(z, vmul(H, vz)));
+		for (int lane = 0; ground && lane < PARTICLE_LANES; lane++) {
+			size_t p = i + lane;
+			if (terrain.solid(posX[p], posY[p], posZ[p])) {
+				collide((uint32_t)p, fromX[lane], fromY[lane], fromZ[lane], h);
+			}
+		}
+		x = vload(&posX[i]);
+		y = vload(&posY[i]);
+		z = vload(&posZ[i]);
+		vstore(&alpha[i], vmul(vsub(death, T), vload(&invLife[i])));
+		vstore(&depth[i], vadd(vadd(vmul(VX, x), vmul(VY, y)), vmul(VZ, z)));
+		int expired = vlessmask(death, T);
+		for (int lane = 0; expired != 0 && lane < PARTICLE_LANES; lane++) {
+			if (expired & (1 << lane)) {
+				dead.push_back((uint32_t)(i + lane));
+			}
+		}
+	}
+#endif
+	for (; i < end; i++) {
+		if (tEnd[i] != FREE) {
+			velX[i] += h * g.x;
+			velY[i] = std::max(velY[i] + h * g.y, -TERMINAL_SPEED);
+			velZ[i] += h * g.z;
+		}
+		float x = posX[i], y = posY[i], z = posZ[i];
+		posX[i] += h * velX[i];
+		posY[i] += h * velY[i];
+		posZ[i] += h * velZ[i];
+		if (ground && terrain.solid(posX[i], posY[i], posZ[i])) {
+			collide((uint32_t)i, x, y, z, h);
+		}
+		alpha[i] = (tEnd[i] - t) * invLife[i];
+		depth[i] = viewZ.x * posX[i] + viewZ.y * posY[i] + viewZ.z * posZ[i];
+		if (tEnd[i] < t) {
+			dead.push_back((uint32_t)i);
+		}
+	}
+}
+
+// Resolved one axis at a time, y then x then z, as VoxelCollider does: each axis takes the
+// new coordinate unless that puts the particle in a block, in which case it stops at the face
+// and bounces, or rests when it lands softly
+void particleSys::collide(uint32_t i, float x, float y, float z, float h)
+{
+	static const int ORDER[3] = {1, 0, 2};
+	// started inside a block (one was placed on it), so let it fall out
+	if (terrain.solid(x, y, z)) {
+		return;
+	}
+	float at[3] = {x, y, z};
+	float to[3] = {posX[i], posY[i], posZ[i]};
+	float *vel[3] = {&velX[i], &velY[i], &velZ[i]};
+	for (int axis : ORDER) {
+		float was = at[axis];
+		at[axis] = to[axis];
+		if (!terrain.solid(at[0], at[1], at[2])) {
+			continue;
+		}
+		bool negative = was > to[axis];
+		at[axis] = std::floor(to[axis]) + (negative ? 1.0f + FACE_OFFSET : -FACE_OFFSET);
+		float &v = *vel[axis];
+		if (axis == 1 && negative && v > -SETTLE_SPEED) {
+			float keep = std::max(0.0f, 1.0f - FRICTION * h);
+			v = 0.0f;
+			velX[i] *= keep;
+			velZ[i] *= keep;
+		} else {
+			v *= -RESTITUTION;
+		}
+	}
+	posX[i] = at[0];
+	posY[i] = at[1];
+	posZ[i] = at[2];
+}
+
+// Copy the blocks that any particle could reach this step: around the live particles and the
+// emitters, padded by the furthest a step can move
+void particleSys::captureTerrain(World &world, float h)
+{
+	bool any = liveCount > 0;
+	vec3 lo = liveMin, hi = liveMax;
+	for (int e = 0; e < MAX_EMITTERS; e++) {
+		if (emitterActive[e]) {
+			lo = any ? glm::min(lo, emitters[e].position) : emitters[e].position;
+			hi = any ? glm::max(hi, emitters[e].position) : emitters[e].position;
+			any = true;
+		}
+	}
+	if (!any) {
+		terrain.clear();
+		return;
+	}
+	int margin = 1 + (int)std::ceil(TERMINAL_SPEED * h);
+	ivec3 from = ivec3(glm::floor(lo)) - ivec3(margin), to = ivec3(glm::floor(hi)) + ivec3(margin);
+	// effects far apart would make a huge copy; keep the middle and skip collisions outside it
+	ivec3 middle = (from + to) / 2;
+	from = glm::max(from, middle - ivec3(MAX_TERRAIN_EXTENT / 2));
+	to = glm::min(to, middle + ivec3(MAX_TERRAIN_EXTENT / 2 - 1));
+	terrain.capture(world, from, to);
+}
+
+void particleSys::pack(GLfloat *stream, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++) {
+		uint32_t p = live[order[i]];
+		GLfloat *out = stream + i * STREAM_FLOATS;
+		out[0] = posX[p];
+		out[1] = posY[p];
+		out[2] = posZ[p];
+		out[3] = color[p].r;
+		out[4] = color[p].g;
+		out[5] = color[p].b;
+		out[6] = alpha[p];
 	}
 }
 
 void particleSys::drawMe(std::shared_ptr<Program> prog) {
 
- 	glBindVertexArray(vertArrObj);
-	int h_pos = prog->getAttribute("vertPos");
-  GLSL::enableVertexAttribArray(h_pos);
-  //std::cout << "Any Gl errors1: " << glGetError() << std::endl;
-  glBindBuffer(GL_ARRAY_BUFFER, vertBuffObj);
-  //std::cout << "Any Gl errors2: " << glGetError() << std::endl;
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glVertexAttribDivisor(0, 1);
-  glVertexAttribDivisor(1, 1);
-  // Draw the points !
-  glDrawArraysInstanced(GL_POINTS, 0, 1, numP);
+	if (liveCount == 0) {
+		return;
+	}
+	GLState::bindVertexArray(vertArrObj);
+	// Draw the points !
+	glDrawArraysInstanced(GL_POINTS, 0, 1, liveCount);
+	// the region may be rewritten once this draw has read it
+	GLsync &fence = ringFences[ringRegion];
+	if (fence) {
+		glDeleteSync(fence);
+	}
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Pack the sorted particles into the next ring region and point the attributes at it
+void particleSys::upload(ThreadPool *pool)
+{
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertBuffObj);
+	if (posX.size() > gpuCapacity) {
+		// the only reallocation, when the particle arrays have grown; it orphans every region
+		gpuCapacity = posX.size();
+		glBufferData(GL_ARRAY_BUFFER, RING_REGIONS * gpuCapacity * STREAM_STRIDE, NULL, GL_STREAM_DRAW);
+		for (GLsync &fence : ringFences) {
+			if (fence) {
+				glDeleteSync(fence);
+			}
+			fence = 0;
+		}
+	}
 
-  glVertexAttribDivisor(0, 0);
-  glVertexAttribDivisor(1, 0);	
+	ringRegion = (ringRegion + 1) % RING_REGIONS;
+	GLsync &fence = ringFences[ringRegion];
+	if (fence) {
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+	GLintptr offset = ringRegion * gpuCapacity * STREAM_STRIDE;
+	GLfloat *out = (GLfloat *)glMapBufferRange(GL_ARRAY_BUFFER, offset, live.size() * STREAM_STRIDE,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (out) {
+		forSlices(pool, live.size(), [this, out](size_t, size_t from, size_t to) { pack(out, from, to); });
+	}
+	// a failed map, or contents lost while mapped, skip this frame's draw
+	if (!out || glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+		liveCount = 0;
+	}
 
-	glDisableVertexAttribArray(0);
+	GLState::bindVertexArray(vertArrObj);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STREAM_STRIDE, (const void *)offset);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, STREAM_STRIDE, (const void *)(offset + 3 * sizeof(GLfloat)));
+	GLState::bindVertexArray(0);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void particleSys::update() {
-
-  vec3 pos;
-  vec4 col;
-
-  //update the particles
-  for(auto particle : particles) {
-        particle->update(t, h, g, start);
-  }
-  t += h;
- 
-  // Sort the particles by Z
-  //temp->rotate(camRot, vec3(0, 1, 0));
-  //be sure that camera matrix is updated prior to this update
-  vec3 s, t, sk;
-  vec4 p;
-  quat r;
-  glm::decompose(theCamera, s, r, t, sk, p);
-  sorter.C = glm::toMat4(r); 
-  sort(particles.begin(), particles.end(), sorter);
-
-
-  //go through all the particles and update the CPU buffer
-   for (int i = 0; i < numP; i++) {
-        pos = particles[i]->getPosition();
-        col = particles[i]->getColor();
-        points[i*3+0] =pos.x; 
-        points[i*3+1] =pos.y; 
-        points[i*3+2] =pos.z; 
-			/*  To do - how can you integrate unique colors per particle?
-        pointColors[i*4+0] =col.r + col.a/10; 
-        pointColors[i*4+1] =col.g + col.g/10; 
-        pointColors[i*4+2] =col.b + col.b/10;
-        pointColors[i*4+3] =col.a;
-			*/
-  } 
-
-  //update the GPU data
-   glBindBuffer(GL_ARRAY_BUFFER, vertBuffObj);
-   glBufferData(GL_ARRAY_BUFFER, sizeof(points), NULL, GL_STREAM_DRAW);
-   glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*numP*3, points);
-   //glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
-   //glBufferData(GL_ARRAY_BUFFER, sizeof(pointColors), NULL, GL_STREAM_DRAW);
-   //glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*numP*4, pointColors);
-   glBindBuffer(GL_ARRAY_BUFFER, 0);
+void particleSys::update(float dt, World &world, ThreadPool *pool) {
+
+	auto begin = chrono::high_resolution_clock::now();
+	float h = std::min(dt, MAX_STEP);
+	t += dt;
+	captureTerrain(world, h);
+	emit(dt);
+	size_t slots = posX.size();
+
+	// camera-space z of a point is this row of the view matrix dotted with it, plus a constant
+	// offset that does not change the order
+	vec3 viewZ(theCamera[0][2], theCamera[1][2], theCamera[2][2]);
+
+	died.resize(std::max(died.size(), sliceCount(pool, slots)));
+	forSlices(pool, slots, [this, h, &viewZ](size_t slice, size_t from, size_t to) {
+		simulate(from, to, h, viewZ, died[slice]);
+	});
+	for (vector<uint32_t> &dead : died) {
+		for (uint32_t i : dead) {
+			tEnd[i] = FREE;
+			alpha[i] = invLife[i] = 0.0f;
+			velX[i] = velY[i] = velZ[i] = 0.0f;
+			freeSlots.push_back(i);
+		}
+		dead.clear();
+	}
+
+	live.clear();
+	liveDepth.clear();
+	for (size_t i = 0; i < slots; i++) {
+		if (tEnd[i] != FREE) {
+			vec3 p(posX[i], posY[i], posZ[i]);
+			liveMin = live.empty() ? p : glm::min(liveMin, p);
+			liveMax = live.empty() ? p : glm::max(liveMax, p);
+			live.push_back((uint32_t)i);
+			liveDepth.push_back(depth[i]);
+		}
+	}
+	liveCount = (int)live.size();
+
+	// Sort the particles by Z, back to front
+	sorter.sort(liveDepth.data(), live.size(), order);
+
+	//update the GPU data
+	if (liveCount > 0) {
+		upload(pool);
+	}
 
+	updateMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
 }
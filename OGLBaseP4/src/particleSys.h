@@ -3,49 +3,109 @@
 #define __particleS__
 
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include "Particle.h"
+#include "DepthSort.h"
 #include "Program.h"
+#include "VoxelCollision.h"
 
 using namespace glm;
 using namespace std;
 
-class ParticleSorter {
-public:
-   bool operator()(const shared_ptr<Particle> p0, const shared_ptr<Particle> p1) const
-   {
-      // Particle positions in world space
-      const vec3 &x0 = p0->getPosition();
-      const vec3 &x1 = p1->getPosition();
-      // Particle positions in camera space
-      vec4 x0w = C * vec4(x0.x, x0.y, x0.z, 1.0f);
-      vec4 x1w = C * vec4(x1.x, x1.y, x1.z, 1.0f);
-      return x0w.z < x1w.z;
-   }
-  
-   mat4 C; // current camera matrix
-};
+class ThreadPool;
+class World;
 
+// Every particle effect in the world, sharing one particle store and one draw call.
+//
+// Particles are kept as a structure of arrays: one array per component, so the update is a
+// straight pass over contiguous floats that runs SIMD lanes at a time and, for large counts,
+// in slices on the worker threads. The same pass writes each particle's camera-space depth,
+// which DepthSort turns into a back-to-front index order. The live state is then packed in
+// that order, as interleaved position and colour, straight into mapped buffer memory. The
+// buffer is a ring of frame-sized regions that is only reallocated when the particle arrays
+// grow. Each frame writes the next region without synchronizing, behind a fence that
+// confirms the GPU has finished the draw that last read it.
+//
+// Effects are short-lived emitters taken from a fixed pool. Each spawns particles into slots
+// popped off a free list, and particles that die push their slot back, so the arrays only
+// grow when more particles are alive at once than ever before.
+//
+// Particles fall under gravity and bounce off or come to rest on blocks. Rather than ask the
+// World about every particle, each update copies the solidity of the blocks around the live
+// particles and emitters into a VoxelSnapshot, and the simulation tests against that.
 class particleSys {
+public:
+	enum { STREAM_FLOATS = 7, MAX_EMITTERS = 64, RING_REGIONS = 3 };
+
 private:
-	vector<shared_ptr<Particle>> particles;
-	float t, h; //?
-	vec3 g; //gravity
-	int numP;
-	vec3 start;
-	ParticleSorter sorter;
-	//this is not great that this is hard coded - you can make it better
-	GLfloat points[900];
-	mat4 theCamera;
+	struct Emitter {
+		vec3 position;
+		float remaining;   // seconds left emitting
+		float rate;        // particles per second
+		float accumulator; // fraction of a particle owed from earlier steps
+	};
+
+	// components, particle i is element i of each
+	vector<float> posX, posY, posZ;
+	vector<float> velX, velY, velZ;
+	vector<float> tEnd;    // time this particle dies, or the largest float for a free slot
+	vector<float> invLife; // 1 / lifespan
+	vector<float> alpha;
+	vector<vec3> color;
+	vector<uint32_t> seed; // per slot so slices never share a generator
+	vector<float> depth;   // camera-space z, the sort key
+
+	vector<uint32_t> freeSlots;
+	vector<vector<uint32_t>> died; // slots that died this step, one list per slice
+	vector<Emitter> emitters;
+	vector<int> freeEmitters;
+	vector<char> emitterActive;
+
+	vector<uint32_t> live;    // slots of the living particles
+	vector<float> liveDepth;
+	vector<uint32_t> order;   // draw order into live, back to front
+	int liveCount;
+	float t;
+	vec3 g; //gravity, blocks/s^2
+	VoxelSnapshot terrain; // blocks around the particles this step
+	vec3 liveMin, liveMax; // bounds of the live particles after the last step
+	DepthSort sorter;
+	mat4 theCamera; // view matrix the particles are sorted for
 	unsigned vertArrObj;
 	unsigned vertBuffObj;
-	
+	size_t gpuCapacity; // particles one ring region holds
+	int ringRegion;     // region the latest particles were written to
+	GLsync ringFences[RING_REGIONS]; // per region, signalled once the draw reading it is done
+	double updateMs;
+
+	void birth(uint32_t i, const vec3 &position);
+	void emit(float dt);
+	// integrate, note the dead and compute sort keys for slots [begin, end)
+	void simulate(size_t begin, size_t end, float h, const vec3 &viewZ, vector<uint32_t> &dead);
+	// particle i moved from (x, y, z) into a solid block: stop it at the face it crossed
+	void collide(uint32_t i, float x, float y, float z, float h);
+	void captureTerrain(World &world, float h);
+	void pack(GLfloat *out, size_t begin, size_t end);
+	void upload(ThreadPool *pool);
+
 public:
-	particleSys(vec3 source);
+	explicit particleSys(int capacity = 300);
 	void drawMe(std::shared_ptr<Program> prog);
 	void gpuSetup();
-	void update();
-	void reSet();
+	// Start an effect at position, emitting rate particles a second for duration seconds.
+	// False when every emitter in the pool is busy.
+	bool addEmitter(const vec3 &position, float duration, float rate);
+	// Advance dt seconds against the terrain of world; without a pool everything runs on the
+	// calling thread
+	void update(float dt, World &world, ThreadPool *pool = nullptr);
+	// Grow the particle arrays to hold at least count particles
+	void reserve(int count);
+	int size() const { return liveCount; }
+	int capacity() const { return (int)posX.size(); }
+	int emitterCount() const { return MAX_EMITTERS - (int)freeEmitters.size(); }
+	double lastUpdateMs() const { return updateMs; }
+	size_t terrainBlocks() const { return terrain.volume(); }
 	void setCamera(mat4 inC) {theCamera = inC;}
 };
 
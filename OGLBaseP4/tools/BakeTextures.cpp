@@ -0,0 +1,48 @@
+/*
+ * Texture baker.
+ * Decodes each image once, builds its full mip chain and writes "<image>.mip" next to it.
+ * Texture then loads the baked file with a single read and uploads every level directly,
+ * skipping both the decode and glGenerateMipmap.
+ *
+ * usage: BakeTextures image...
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "ImageData.h"
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: %s image...\n", argv[0]);
+		return 1;
+	}
+
+	int failed = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string source = argv[i];
+		ImageData image;
+		if (!decodeImage(source, image))
+		{
+			failed++;
+			continue;
+		}
+		// stored in upload order; cube faces are flipped back when they are loaded
+		image.flipRows();
+		image.buildMips();
+
+		std::string path = bakedPath(source);
+		if (!writeBaked(path, image))
+		{
+			fprintf(stderr, "could not write %s\n", path.c_str());
+			failed++;
+			continue;
+		}
+		printf("%s: %dx%d, %d channels, %zu levels\n", path.c_str(), image.width(), image.height(),
+			image.channels, image.levels.size());
+	}
+	return failed == 0 ? 0 : 1;
+}
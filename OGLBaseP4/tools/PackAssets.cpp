@@ -0,0 +1,200 @@
+/*
+ * Asset packer.
+ * Packs shader sources, images (decoded, in upload row order, with a full mip chain no more
+ * than MAX_PACKED_SIZE texels on a side) and OBJ files (parsed into interleaved meshes) from a
+ * resource directory into one archive that the application memory-maps at startup instead of
+ * opening and parsing loose files.
+ *
+ * usage: PackAssets <resource dir> <archive> [file...]
+ * With no files listed, everything the application loads is packed.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <tiny_obj_loader/tiny_obj_loader.h>
+
+#include "AssetArchive.h"
+#include "ImageData.h"
+#include "MeshData.h"
+
+using namespace std;
+
+// Larger images are packed from the first mip that fits: the full chain of the 8192x8192
+// Steve texture is 270 MB, which the texture upload reads in full
+static const int MAX_PACKED_SIZE = 2048;
+
+static const char *DEFAULT_ASSETS[] = {
+	"lit_vert.glsl", "lit_frag.glsl", "skybox_vert.glsl", "skybox_frag.glsl",
+	"particle_vert.glsl", "particle_frag.glsl", "particle_update_vert.glsl", "particle_update_frag.glsl",
+	"horizon_vert.glsl", "horizon_frag.glsl",
+	"texture_atlas.jpg", "steve_texture.jpg", "diamond.png",
+	"skybox/Daylight Box_Right.bmp", "skybox/Daylight Box_Left.bmp", "skybox/Daylight Box_Top.bmp",
+	"skybox/Daylight Box_Bottom.bmp", "skybox/Daylight Box_Front.bmp", "skybox/Daylight Box_Back.bmp",
+	"cartoon_flower.obj", "Steve.obj", "creeper.obj", "cube.obj", "diamond.obj"
+};
+
+static bool endsWith(const string &s, const string &suffix)
+{
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool readText(const string &path, vector<unsigned char> &out)
+{
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	out.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	return true;
+}
+
+// Images are stored in the row order they are uploaded in, so mapping them needs no copy:
+// bottom-up for 2D textures, top-down for the skybox cube faces
+static bool packImage(const string &path, bool bottomUp, vector<unsigned char> &out)
+{
+	ImageData image;
+	if (!decodeImage(path, image))
+	{
+		return false;
+	}
+	if (image.bottomUp != bottomUp)
+	{
+		image.flipRows();
+	}
+	image.buildMips();
+	size_t first = 0;
+	while (first + 1 < image.levels.size() && max(image.levels[first].width, image.levels[first].height) > MAX_PACKED_SIZE)
+	{
+		first++;
+	}
+	image.levels.erase(image.levels.begin(), image.levels.begin() + first);
+	return encodeBaked(image, out);
+}
+
+// Zero-fill up to the next ALIGNMENT boundary; blobs and the entry table all start on one
+static void align(ofstream &archive, uint64_t &offset)
+{
+	static const char zeros[AssetArchive::ALIGNMENT] = {};
+	size_t pad = (AssetArchive::ALIGNMENT - offset % AssetArchive::ALIGNMENT) % AssetArchive::ALIGNMENT;
+	archive.write(zeros, pad);
+	offset += pad;
+}
+
+static bool packObj(const string &path, vector<unsigned char> &out)
+{
+	vector<tinyobj::shape_t> shapes;
+	vector<tinyobj::material_t> materials;
+	string err;
+	if (!tinyobj::LoadObj(shapes, materials, err, path.c_str()))
+	{
+		fprintf(stderr, "%s: %s\n", path.c_str(), err.c_str());
+		return false;
+	}
+	vector<MeshData> meshes(shapes.size());
+	for (size_t i = 0; i < shapes.size(); i++)
+	{
+		buildMeshData(shapes[i], meshes[i]);
+	}
+	packMeshes(meshes, out);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		printf("usage: %s <resource dir> <archive> [file...]\n", argv[0]);
+		return 1;
+	}
+	string root = argv[1];
+	vector<string> names;
+	for (int i = 3; i < argc; i++)
+	{
+		names.push_back(argv[i]);
+	}
+	if (names.empty())
+	{
+		names.assign(begin(DEFAULT_ASSETS), end(DEFAULT_ASSETS));
+	}
+
+	ofstream archive(argv[2], ios::binary | ios::trunc);
+	if (!archive.is_open())
+	{
+		fprintf(stderr, "could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	AssetArchive::Header header;
+	memset(&header, 0, sizeof(header));
+	archive.write((const char *)&header, sizeof(header));
+
+	vector<AssetArchive::Entry> entries;
+	uint64_t offset = sizeof(header);
+	int failed = 0;
+	for (const string &name : names)
+	{
+		string path = root + "/" + name;
+		vector<unsigned char> blob;
+		AssetArchive::Type type;
+		bool ok;
+		if (endsWith(name, ".obj"))
+		{
+			type = AssetArchive::ASSET_MESHES;
+			ok = packObj(path, blob);
+		}
+		else if (endsWith(name, ".jpg") || endsWith(name, ".png") || endsWith(name, ".bmp"))
+		{
+			type = AssetArchive::ASSET_IMAGE;
+			ok = packImage(path, name.compare(0, 7, "skybox/") != 0, blob);
+		}
+		else
+		{
+			type = AssetArchive::ASSET_TEXT;
+			ok = readText(path, blob);
+		}
+		// stamped so the application can tell when the loose file has been edited since
+		AssetArchive::Stamp source;
+		if (!ok || !AssetArchive::stamp(path, source) || name.size() >= AssetArchive::NAME_LENGTH)
+		{
+			fprintf(stderr, "skipping %s\n", path.c_str());
+			failed++;
+			continue;
+		}
+
+		align(archive, offset);
+
+		AssetArchive::Entry entry;
+		memset(&entry, 0, sizeof(entry));
+		strncpy(entry.name, name.c_str(), AssetArchive::NAME_LENGTH - 1);
+		entry.type = type;
+		entry.offset = offset;
+		entry.size = blob.size();
+		entry.sourceTime = source.time;
+		entry.sourceSize = source.size;
+		entries.push_back(entry);
+
+		archive.write((const char *)blob.data(), blob.size());
+		offset += blob.size();
+		printf("%-32s %9zu bytes\n", name.c_str(), blob.size());
+	}
+
+	// the table is read in place through an Entry pointer
+	align(archive, offset);
+	memcpy(header.magic, AssetArchive::MAGIC, sizeof(header.magic));
+	header.version = AssetArchive::VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.tableOffset = offset;
+	archive.write((const char *)entries.data(), entries.size() * sizeof(AssetArchive::Entry));
+	archive.seekp(0);
+	archive.write((const char *)&header, sizeof(header));
+	archive.close();
+
+	printf("%s: %zu entries, %llu bytes\n", argv[2], entries.size(), (unsigned long long)(offset + entries.size() * sizeof(AssetArchive::Entry)));
+	return failed == 0 ? 0 : 1;
+}